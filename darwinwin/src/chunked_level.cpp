@@ -0,0 +1,269 @@
+#include "chunked_level.h"
+#include "testable.h"
+
+REGISTER_TESTABLE_FILE(3);
+
+static lsResult chunked_level_getUniformChunk(chunked_level *pLevel, const tileFlag value, _Out_ level_chunk **ppChunk)
+{
+  lsResult result = lsR_Success;
+
+  if (pLevel->pUniformChunks[value] == nullptr)
+  {
+    LS_ERROR_CHECK(lsAllocAligned(&pLevel->pUniformChunks[value]));
+    lsMemset(pLevel->pUniformChunks[value]->grid, level_chunk::total, value);
+  }
+
+  *ppChunk = pLevel->pUniformChunks[value];
+
+epilogue:
+  return result;
+}
+
+chunked_level::~chunked_level()
+{
+  chunked_level_destroy(this);
+}
+
+lsResult chunked_level_init(chunked_level *pLevel, const size_t width, const size_t height, const tileFlag defaultTile)
+{
+  lsResult result = lsR_Success;
+
+  level_chunk *pDefaultChunk = nullptr;
+
+  LS_ERROR_IF(pLevel == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(width == 0 || height == 0 || width % level_chunk::width != 0 || height % level_chunk::height != 0, lsR_InvalidParameter);
+  LS_ERROR_IF(width > lsMaxValue<uint16_t>() || height > lsMaxValue<uint16_t>(), lsR_ArgumentOutOfBounds); // positions are `vec2u16`.
+
+  chunked_level_destroy(pLevel);
+
+  pLevel->width = width;
+  pLevel->height = height;
+  pLevel->chunkCountX = width / level_chunk::width;
+  pLevel->chunkCountY = height / level_chunk::height;
+
+  LS_ERROR_CHECK(lsAlloc(&pLevel->ppChunks, pLevel->chunkCountX * pLevel->chunkCountY));
+  LS_ERROR_CHECK(chunked_level_getUniformChunk(pLevel, defaultTile, &pDefaultChunk));
+
+  for (size_t i = 0; i < pLevel->chunkCountX * pLevel->chunkCountY; i++)
+    pLevel->ppChunks[i] = pDefaultChunk;
+
+epilogue:
+  if (LS_FAILED(result) && pLevel != nullptr)
+    chunked_level_destroy(pLevel);
+
+  return result;
+}
+
+void chunked_level_destroy(chunked_level *pLevel)
+{
+  if (pLevel == nullptr)
+    return;
+
+  if (pLevel->ppChunks != nullptr)
+    for (size_t i = 0; i < pLevel->chunkCountX * pLevel->chunkCountY; i++)
+      if (pLevel->ppChunks[i] != nullptr && !chunked_level_isShared(*pLevel, pLevel->ppChunks[i]))
+        lsFreeAlignedPtr(&pLevel->ppChunks[i]);
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(pLevel->pUniformChunks); i++)
+    lsFreeAlignedPtr(&pLevel->pUniformChunks[i]);
+
+  lsFreePtr(&pLevel->ppChunks);
+
+  pLevel->width = 0;
+  pLevel->height = 0;
+  pLevel->chunkCountX = 0;
+  pLevel->chunkCountY = 0;
+  pLevel->ownedChunkCount = 0;
+  pLevel->generation++;
+}
+
+lsResult chunked_level_set(chunked_level *pLevel, const vec2u16 pos, const tileFlag value)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pLevel == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pos.x >= pLevel->width || pos.y >= pLevel->height, lsR_ArgumentOutOfBounds);
+
+  {
+    level_chunk **ppChunk = &pLevel->ppChunks[(pos.y >> level_chunk::size_bits) * pLevel->chunkCountX + (pos.x >> level_chunk::size_bits)];
+    const size_t tileIndex = (pos.y & (level_chunk::height - 1)) * level_chunk::width + (pos.x & (level_chunk::width - 1));
+
+    if ((*ppChunk)->grid[tileIndex] == value)
+      goto epilogue;
+
+    if (chunked_level_isShared(*pLevel, *ppChunk))
+    {
+      level_chunk *pCopy = nullptr;
+      LS_ERROR_CHECK(lsAllocAligned(&pCopy));
+      lsMemcpy(pCopy->grid, (*ppChunk)->grid, level_chunk::total);
+
+      *ppChunk = pCopy;
+      pLevel->ownedChunkCount++;
+      pLevel->generation++;
+    }
+
+    (*ppChunk)->grid[tileIndex] = value;
+  }
+
+epilogue:
+  return result;
+}
+
+lsResult chunked_level_fillChunk(chunked_level *pLevel, const size_t chunkX, const size_t chunkY, const tileFlag value)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pLevel == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(chunkX >= pLevel->chunkCountX || chunkY >= pLevel->chunkCountY, lsR_ArgumentOutOfBounds);
+
+  {
+    level_chunk *pUniform = nullptr;
+    LS_ERROR_CHECK(chunked_level_getUniformChunk(pLevel, value, &pUniform));
+
+    level_chunk **ppChunk = &pLevel->ppChunks[chunkY * pLevel->chunkCountX + chunkX];
+
+    if (*ppChunk == pUniform)
+      goto epilogue;
+
+    if (!chunked_level_isShared(*pLevel, *ppChunk))
+    {
+      lsFreeAlignedPtr(ppChunk);
+      pLevel->ownedChunkCount--;
+    }
+
+    *ppChunk = pUniform;
+    pLevel->generation++;
+  }
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "level_generator.h"
+
+DEFINE_TESTABLE(chunked_level_sharing_test)
+{
+  lsResult result = lsR_Success;
+
+  chunked_level lvl;
+  chunked_level_cursor cursor;
+
+  TESTABLE_ASSERT_SUCCESS(chunked_level_init(&lvl, level_chunk::width * 64, level_chunk::height * 64, tf_Underwater));
+  TESTABLE_ASSERT_EQUAL(lvl.ownedChunkCount, (size_t)0);
+
+  {
+    const vec2u16 pos((uint16_t)(level_chunk::width + 10), (uint16_t)10);
+
+    TESTABLE_ASSERT_EQUAL(chunked_level_get(lvl, pos), tf_Underwater);
+    TESTABLE_ASSERT_EQUAL(chunked_level_resolve(lvl, &cursor, pos), lvl.pUniformChunks[tf_Underwater]);
+
+    // Writing the value that's already there doesn't copy.
+    TESTABLE_ASSERT_SUCCESS(chunked_level_set(&lvl, pos, tf_Underwater));
+    TESTABLE_ASSERT_EQUAL(lvl.ownedChunkCount, (size_t)0);
+
+    TESTABLE_ASSERT_SUCCESS(chunked_level_set(&lvl, pos, tf_Underwater | tf_Fat));
+    TESTABLE_ASSERT_SUCCESS(chunked_level_set(&lvl, vec2u16((uint16_t)(pos.x + 1), pos.y), tf_Collidable));
+    TESTABLE_ASSERT_EQUAL(lvl.ownedChunkCount, (size_t)1);
+
+    // The cursor picks up the copy.
+    TESTABLE_ASSERT_NOT_EQUAL(chunked_level_resolve(lvl, &cursor, pos), lvl.pUniformChunks[tf_Underwater]);
+    TESTABLE_ASSERT_EQUAL(chunked_level_getNear(lvl, &cursor, pos, pos), tf_Underwater | tf_Fat);
+
+    const viewCone cone = chunked_level_viewCone_get<viewCone_shape_default>(lvl, &cursor, vec2u16((uint16_t)(pos.x - 1), pos.y), ld_right);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_nearCenter], tf_Underwater | tf_Fat);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_midCenter], tf_Collidable);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_farCenter], tf_Hidden);
+
+    // Untouched chunks are still shared.
+    TESTABLE_ASSERT_EQUAL(chunked_level_get(lvl, vec2u16((uint16_t)(pos.x + level_chunk::width), pos.y)), tf_Underwater);
+    TESTABLE_ASSERT_EQUAL(lvl.ownedChunkCount, (size_t)1);
+
+    TESTABLE_ASSERT_SUCCESS(chunked_level_fillChunk(&lvl, 1, 0, tf_Underwater));
+    TESTABLE_ASSERT_EQUAL(lvl.ownedChunkCount, (size_t)0);
+    TESTABLE_ASSERT_EQUAL(chunked_level_getNear(lvl, &cursor, pos, pos), tf_Underwater);
+  }
+
+  // Out of the level is collidable.
+  {
+    const viewCone cone = chunked_level_viewCone_get<viewCone_shape_default>(lvl, &cursor, vec2u16(0, 0), ld_up);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_self], tf_Underwater);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_nearCenter], tf_Collidable);
+
+    actor_state state;
+    lsZeroMemory(&state);
+    state.look_at_dir = ld_left;
+    state.stats[as_Energy] = 128;
+
+    actor_move(&state, lvl, &cursor);
+    TESTABLE_ASSERT_EQUAL(state.pos, vec2u16(0, 0));
+  }
+
+  goto epilogue;
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(chunked_level_flat_equivalence_test)
+{
+  lsResult result = lsR_Success;
+
+  level_128 *pFlat = nullptr;
+  chunked_level lvl;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pFlat));
+  TESTABLE_ASSERT_SUCCESS(chunked_level_init(&lvl, level_128::width, level_128::height, tf_Underwater));
+
+  level_gen_water_food_level(pFlat);
+
+  for (size_t y = 0; y < level_128::height; y++)
+    for (size_t x = 0; x < level_128::width; x++)
+      TESTABLE_ASSERT_SUCCESS(chunked_level_set(&lvl, vec2u16((uint16_t)x, (uint16_t)y), pFlat->grid[y * level_128::width + x]));
+
+  for (size_t y = level_128::wallThickness; y < level_128::height - level_128::wallThickness; y++)
+  {
+    for (size_t x = level_128::wallThickness; x < level_128::width - level_128::wallThickness; x++)
+    {
+      if (pFlat->grid[y * level_128::width + x] & tf_Collidable)
+        continue;
+
+      chunked_level_cursor cursor;
+
+      for (size_t dir = 0; dir < _lookDirection_Count; dir++)
+      {
+        const vec2u16 pos((uint16_t)x, (uint16_t)y);
+
+        const viewCone flatCone = viewCone_get<viewCone_shape_default>(*pFlat, pos, (lookDirection)dir);
+        const viewCone chunkedCone = chunked_level_viewCone_get<viewCone_shape_default>(lvl, &cursor, pos, (lookDirection)dir);
+        TESTABLE_ASSERT_EQUAL(memcmp(flatCone.values, chunkedCone.values, sizeof(flatCone.values)), 0);
+
+        actor_state flatActor;
+        lsZeroMemory(&flatActor);
+        flatActor.pos = pos;
+        flatActor.look_at_dir = (lookDirection)dir;
+        flatActor.stats[as_Energy] = 128;
+
+        actor_state chunkedActor = flatActor;
+
+        if (y % 2)
+        {
+          actor_move(&flatActor, *pFlat);
+          actor_move(&chunkedActor, lvl, &cursor);
+        }
+        else
+        {
+          actor_moveTwo(&flatActor, *pFlat);
+          actor_moveTwo(&chunkedActor, lvl, &cursor);
+        }
+
+        TESTABLE_ASSERT_EQUAL(flatActor.pos, chunkedActor.pos);
+        TESTABLE_ASSERT_EQUAL(flatActor.stats[as_Energy], chunkedActor.stats[as_Energy]);
+      }
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pFlat);
+  return result;
+}
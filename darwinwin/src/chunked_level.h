@@ -0,0 +1,154 @@
+#pragma once
+
+#include "darwinwin.h"
+
+// A level that is too large to be stored as one flat grid. The tiles are split into `level_chunk`s, chunks that only contain a single tile value share one immutable chunk per value and are only copied once a tile is written to them.
+// Everything outside of the level is collidable, there are no implicit walls.
+
+struct level_chunk
+{
+  static constexpr size_t size_bits = 6;
+  static constexpr size_t width = 1ULL << size_bits;
+  static constexpr size_t height = width;
+  static constexpr size_t total = width * height;
+
+  uint8_t grid[total];
+};
+
+struct chunked_level
+{
+  size_t width = 0;
+  size_t height = 0;
+  size_t chunkCountX = 0;
+  size_t chunkCountY = 0;
+
+  level_chunk **ppChunks = nullptr; // `chunkCountX * chunkCountY`, either one of `pUniformChunks` or owned by the level.
+  level_chunk *pUniformChunks[256] = {}; // one shared chunk per tile value, allocated when first needed.
+  size_t ownedChunkCount = 0;
+  uint64_t generation = 0; // incremented whenever a chunk is replaced, so cached chunk pointers can be invalidated.
+
+  inline chunked_level() {};
+  inline chunked_level(const chunked_level &) = delete;
+  chunked_level &operator =(const chunked_level &) = delete;
+
+  ~chunked_level();
+};
+
+// `width` and `height` have to be multiples of `level_chunk::width`.
+lsResult chunked_level_init(chunked_level *pLevel, const size_t width, const size_t height, const tileFlag defaultTile);
+void chunked_level_destroy(chunked_level *pLevel);
+
+// Writes a tile, copies the chunk first if it's shared. Writing the value that is already there never copies.
+lsResult chunked_level_set(chunked_level *pLevel, const vec2u16 pos, const tileFlag value);
+
+// Replaces a whole chunk with the shared chunk of `value`, releasing the owned chunk (if any).
+lsResult chunked_level_fillChunk(chunked_level *pLevel, const size_t chunkX, const size_t chunkY, const tileFlag value);
+
+inline bool chunked_level_isShared(const chunked_level &lvl, const level_chunk *pChunk)
+{
+  return pChunk == lvl.pUniformChunks[pChunk->grid[0]];
+}
+
+inline bool chunked_level_contains(const chunked_level &lvl, const int64_t x, const int64_t y)
+{
+  return x >= 0 && y >= 0 && x < (int64_t)lvl.width && y < (int64_t)lvl.height;
+}
+
+inline uint8_t chunked_level_get(const chunked_level &lvl, const vec2u16 pos)
+{
+  lsAssert(pos.x < lvl.width && pos.y < lvl.height);
+
+  const level_chunk *pChunk = lvl.ppChunks[(pos.y >> level_chunk::size_bits) * lvl.chunkCountX + (pos.x >> level_chunk::size_bits)];
+  return pChunk->grid[(pos.y & (level_chunk::height - 1)) * level_chunk::width + (pos.x & (level_chunk::width - 1))];
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// The chunk an actor was last seen in. Kept per actor, so consecutive lookups around the actor don't have to go through the chunk table.
+struct chunked_level_cursor
+{
+  size_t chunkIndex = (size_t)-1;
+  uint64_t generation = 0;
+  const level_chunk *pChunk = nullptr;
+};
+
+inline const level_chunk *chunked_level_resolve(const chunked_level &lvl, chunked_level_cursor *pCursor, const vec2u16 pos)
+{
+  lsAssert(pos.x < lvl.width && pos.y < lvl.height);
+
+  const size_t chunkIndex = (pos.y >> level_chunk::size_bits) * lvl.chunkCountX + (pos.x >> level_chunk::size_bits);
+
+  if (pCursor->chunkIndex != chunkIndex || pCursor->generation != lvl.generation)
+  {
+    pCursor->chunkIndex = chunkIndex;
+    pCursor->generation = lvl.generation;
+    pCursor->pChunk = lvl.ppChunks[chunkIndex];
+  }
+
+  return pCursor->pChunk;
+}
+
+// Looks up a tile close to the actor, without going through the chunk table if it's in the actor's chunk.
+inline uint8_t chunked_level_getNear(const chunked_level &lvl, chunked_level_cursor *pCursor, const vec2u16 actorPos, const vec2u16 pos)
+{
+  const level_chunk *pChunk = chunked_level_resolve(lvl, pCursor, actorPos);
+
+  if ((pos.x >> level_chunk::size_bits) != (actorPos.x >> level_chunk::size_bits) || (pos.y >> level_chunk::size_bits) != (actorPos.y >> level_chunk::size_bits))
+    return chunked_level_get(lvl, pos);
+
+  return pChunk->grid[(pos.y & (level_chunk::height - 1)) * level_chunk::width + (pos.x & (level_chunk::width - 1))];
+}
+
+// Like `viewCone_get`, but without other actors. If the whole cone lies within the actor's chunk, the tiles are read straight from the cached chunk.
+template <typename shape>
+viewCone_t<shape> chunked_level_viewCone_get(const chunked_level &lvl, chunked_level_cursor *pCursor, const vec2u16 pos, const lookDirection dir)
+{
+  constexpr const viewCone_layout<shape, level_chunk::width> &layout = viewCone_layout_of<shape, level_chunk::width>;
+  static_assert(layout.occludersInShape);
+  static_assert(layout.reach < level_chunk::width / 2);
+
+  lsAssert(dir < _lookDirection_Count);
+
+  viewCone_t<shape> ret;
+  uint64_t collidable = 0;
+
+  const level_chunk *pChunk = chunked_level_resolve(lvl, pCursor, pos);
+  const size_t localX = pos.x & (level_chunk::width - 1);
+  const size_t localY = pos.y & (level_chunk::height - 1);
+
+  if (localX >= layout.reach && localX < level_chunk::width - layout.reach && localY >= layout.reach && localY < level_chunk::height - layout.reach)
+  {
+    const size_t currentIdx = localY * level_chunk::width + localX;
+
+    for (size_t i = 0; i < layout.count; i++)
+      ret.values[i] = pChunk->grid[currentIdx + layout.tileOffset[dir][i]];
+  }
+  else
+  {
+    for (size_t i = 0; i < layout.count; i++)
+    {
+      const viewCone_cell c = shape::cell(i);
+      const int64_t x = (int64_t)pos.x + (dir == ld_left ? -c.forward : dir == ld_right ? c.forward : dir == ld_up ? c.lateral : -c.lateral);
+      const int64_t y = (int64_t)pos.y + (dir == ld_up ? -c.forward : dir == ld_down ? c.forward : dir == ld_right ? c.lateral : -c.lateral);
+
+      ret.values[i] = chunked_level_contains(lvl, x, y) ? chunked_level_get(lvl, vec2u16(x, y)) : (uint8_t)tf_Collidable;
+    }
+  }
+
+  for (size_t i = 0; i < layout.count; i++)
+    collidable |= (uint64_t)!!(ret.values[i] & tf_Collidable) << i;
+
+  // hidden flags
+  for (size_t i = 0; i < layout.count; i++)
+    if (collidable & layout.occluders[i])
+      ret.values[i] = tf_Hidden;
+
+  return ret;
+}
+
+// The same rules as `actor_move` and `actor_moveTwo` (defined next to them), tiles are looked up through the actor's cursor.
+template <typename rules = actor_rules_default>
+void actor_move(actor_state *pActor, const chunked_level &lvl, chunked_level_cursor *pCursor);
+
+template <typename rules = actor_rules_default>
+void actor_moveTwo(actor_state *pActor, const chunked_level &lvl, chunked_level_cursor *pCursor);
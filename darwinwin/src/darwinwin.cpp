@@ -1,13 +1,17 @@
 #include "darwinwin.h"
+#include "chunked_level.h"
+#include "replay.h"
 #include "io.h"
+#include "testable.h"
 
 #include <filesystem>
 
-void actor_move(actor *pActor, const level &lvl);
-void actor_moveTwo(actor *pActor, const level &lvl);
-void actor_turnLeft(actor *pActor);
-void actor_turnRight(actor *pActor);
-void actor_eat(actor *pActor, level *pLvl, const viewCone &cone);
+REGISTER_TESTABLE_FILE(2);
+
+template <typename rules> void actor_turnLeft(actor_state *pActor);
+template <typename rules> void actor_turnRight(actor_state *pActor);
+template <typename rules, typename level_type> void actor_eat(actor_state *pActor, level_type *pLvl, const viewCone &cone, const std::type_identity_t<level_step_options_t<level_type>> *pOptions);
+template <typename rules> static void actor_updateStats_range(actor_population *pPopulation, const viewCone *pCones, const size_t first, const size_t end);
 
 const char *lookDirection_toName[] =
 {
@@ -70,6 +74,23 @@ void level_initLinear(level *pLevel)
   }
 }
 
+vec2u8 level_getRandomInteriorPosition()
+{
+  return vec2u8((uint8_t)(level::wallThickness + lsGetRand() % (level::width - level::wallThickness * 2)), (uint8_t)(level::wallThickness + lsGetRand() % (level::height - level::wallThickness * 2)));
+}
+
+vec2u8 level_getRandomFreePosition(const level &lvl)
+{
+  vec2u8 pos;
+
+  do
+  {
+    pos = level_getRandomInteriorPosition();
+  } while (lvl.grid[pos.y * level::width + pos.x] & tf_Collidable);
+
+  return pos;
+}
+
 void printEmptyTile()
 {
   lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
@@ -122,406 +143,3190 @@ void level_print(const level &level)
   print('\n');
 }
 
-bool level_performStep(level &lvl, actor *pActors, const size_t actorCount)
-{
-  // TODO: optional level internal step. (grow plants, etc.)
+//////////////////////////////////////////////////////////////////////////
 
-  bool anyAlive = false;
+static_assert(level::width % sizeof(__m256i) == 0);
 
-  for (size_t i = 0; i < actorCount; i++)
-  {
-    if (!pActors[i].stats[as_Energy])
-      continue;
+constexpr struct { tileFlag food; bool underwater; } level_plant_growth_foods[] =
+{
+  { tf_Protein, false },
+  { tf_Sugar, false },
+  { tf_Vitamin, true },
+  { tf_Fat, true },
+};
 
-    anyAlive = true;
+static_assert(LS_ARRAYSIZE(level_plant_growth_foods) == _actorStats_FoodEnd - _actorStats_FoodBegin + 1);
 
-    const viewCone cone = viewCone_get(lvl, pActors[i]);
-    actor_updateStats(&pActors[i], cone);
+inline static bool level_plant_growth_getRow(const uint64_t *pRows, const size_t y)
+{
+  return (pRows[y / 64] >> (y % 64)) & 1;
+}
 
-    decltype(actor::brain)::io_buffer_t ioBuffer;
+inline static void level_plant_growth_setRow(uint64_t *pRows, const size_t y)
+{
+  pRows[y / 64] |= 1ULL << (y % 64);
+}
 
-    for (size_t j = 0; j < LS_ARRAYSIZE(cone.values); j++)
-      for (size_t k = 0, bit = 1; k < 8; k++, bit <<= 1)
-        ioBuffer[j * 8 + k] = (int8_t)(cone[(viewConePosition)j] & bit);
+// Grows 32 tiles starting at `pSelf` (the same stencil as `level_gen_grow`, but for all food types at once).
+inline static __m256i level_growPlants_tiles(const uint8_t *pSelf)
+{
+  const __m256i self = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSelf));
+  const __m256i up = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSelf - level::width));
+  const __m256i down = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSelf + level::width));
+  const __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSelf - 1));
+  const __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSelf + 1));
 
-    neural_net_buffer_prepare(ioBuffer, (LS_ARRAYSIZE(cone.values) * 8) / ioBuffer.block_size);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i underwaterFlag = _mm256_set1_epi8(tf_Underwater);
+  const __m256i passable = _mm256_cmpeq_epi8(_mm256_and_si256(self, _mm256_set1_epi8(tf_Collidable)), zero);
+  const __m256i underwater = _mm256_cmpeq_epi8(_mm256_and_si256(self, underwaterFlag), underwaterFlag);
+  const __m256i threshold = _mm256_set1_epi8(level_plant_growth::neighbourThreshold - 1);
 
-    for (size_t j = 0; j < _actorStats_Count; j++)
-      ioBuffer[LS_ARRAYSIZE(cone.values) * 8 + j] = (int8_t)((int64_t)pActors[i].stats[j] - 128);
+  __m256i grown = self;
 
-    neural_net_eval(pActors[i].brain, ioBuffer);
+  for (const auto &type : level_plant_growth_foods)
+  {
+    const __m256i food = _mm256_set1_epi8((int8_t)type.food);
 
-    int16_t maxValue = ioBuffer.data[0];
-    size_t bestActionIndex = 0;
-    constexpr size_t maxActionIndex = lsMin(LS_ARRAYSIZE(ioBuffer.data), _actorAction_Count);
+    // Every neighbour with food adds -1.
+    const __m256i negativeCount = _mm256_add_epi8(
+      _mm256_add_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(up, food), food), _mm256_cmpeq_epi8(_mm256_and_si256(down, food), food)),
+      _mm256_add_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(left, food), food), _mm256_cmpeq_epi8(_mm256_and_si256(right, food), food)));
 
-    for (size_t actionIndex = 1; actionIndex < maxActionIndex; actionIndex++)
-    {
-      if (maxValue < ioBuffer.data[actionIndex])
-      {
-        maxValue = ioBuffer.data[actionIndex];
-        bestActionIndex = actionIndex;
-      }
-    }
+    const __m256i enough = _mm256_cmpgt_epi8(_mm256_sub_epi8(zero, negativeCount), threshold);
+    const __m256i habitat = type.underwater ? _mm256_and_si256(passable, underwater) : _mm256_andnot_si256(underwater, passable);
 
-    actor_act(&pActors[i], &lvl, cone, (actorAction)bestActionIndex);
+    grown = _mm256_or_si256(grown, _mm256_and_si256(_mm256_and_si256(enough, habitat), food));
   }
 
-  lsAssert(anyAlive); // otherwise, maybe don't call us???
-
-  return anyAlive;
+  return grown;
 }
 
-//////////////////////////////////////////////////////////////////////////
+void level_plant_growth_init(level_plant_growth *pGrowth)
+{
+  pGrowth->stepsUntilUpdate = level_plant_growth::interval;
+  lsMemset(pGrowth->activeRows, LS_ARRAYSIZE(pGrowth->activeRows), 0xFF); // nothing has been evaluated yet.
+}
 
-viewCone viewCone_get(const level &lvl, const actor &a)
+bool level_growPlants(level *pLevel, level_plant_growth *pGrowth, level_undo_log *pUndoLog /* = nullptr */)
 {
-  lsAssert(a.pos.x > 0 && a.pos.y < level::width);
+  lsAssert(pGrowth->stepsUntilUpdate > 0);
 
-  viewCone ret;
+  if (--pGrowth->stepsUntilUpdate != 0)
+    return false;
 
-  size_t currentIdx = a.pos.y * level::width + a.pos.x;
-  constexpr ptrdiff_t width = (ptrdiff_t)level::width;
-  static const ptrdiff_t lut[_lookDirection_Count][LS_ARRAYSIZE(ret.values)] = {
-    { 0, width - 1, -1, -width - 1, width - 2, -2, -width - 2, -3 },
-    { 0, -width - 1, -width, -width + 1, -width * 2 - 1, -width * 2, -width * 2 + 1, -width * 3 },
-    { 0, -width + 1, 1, width + 1, -width + 2, 2, width + 2, 3 },
-    { 0, width + 1, width, width - 1, width * 2 + 1, width * 2, width * 2 - 1, width * 3 },
-  };
+  pGrowth->stepsUntilUpdate = level_plant_growth::interval;
 
-  for (size_t i = 0; i < LS_ARRAYSIZE(ret.values); i++)
-    ret.values[i] = lvl.grid[currentIdx + lut[a.look_at_dir][i]];
+  // Rows that changed since the last update (marked by the writers or grown in the last update).
+  uint64_t changedRows[level_plant_growth::rowMaskCount];
+  lsMemcpy(changedRows, pGrowth->activeRows, LS_ARRAYSIZE(changedRows));
 
-  // hidden flags
-  if (ret.values[vcp_nearLeft] & tf_Collidable)
-    ret.values[vcp_midLeft] = tf_Hidden;
+  // Only rows next to a changed row can grow.
+  uint64_t grownRows[level_plant_growth::rowMaskCount];
+  lsZeroMemory(grownRows, LS_ARRAYSIZE(grownRows));
 
-  if (ret.values[vcp_nearCenter] & tf_Collidable)
-  {
-    ret.values[vcp_midCenter] = tf_Hidden;
-    ret.values[vcp_farCenter] = tf_Hidden;
-  }
-  else if (ret.values[vcp_midCenter] & tf_Collidable)
+  // All tiles grow from the state before the update, so every grown row is only written once the row below it has been evaluated as well.
+  static_assert(level::width == sizeof(__m256i));
+
+  __m256i pendingRow = _mm256_setzero_si256();
+  size_t pendingY = 0; // 0 if nothing is pending, that's always a wall.
+  bool anyGrown = false;
+
+  const auto writePendingRow = [&]()
+    {
+      if (pendingY == 0)
+        return;
+
+      const size_t lineIdx = pendingY * level::width;
+
+      if (pUndoLog != nullptr)
+      {
+        const uint32_t unchanged = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(pendingRow, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pLevel->grid + lineIdx))));
+
+        for (uint32_t changed = ~unchanged; changed != 0; changed &= changed - 1)
+          level_undo_log_record(pUndoLog, *pLevel, lineIdx + lsLowestBit(changed));
+      }
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(pLevel->grid + lineIdx), pendingRow);
+      pendingY = 0;
+    };
+
+  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
   {
-    ret.values[vcp_farCenter] = tf_Hidden;
+    if (!level_plant_growth_getRow(changedRows, y - 1) && !level_plant_growth_getRow(changedRows, y) && !level_plant_growth_getRow(changedRows, y + 1))
+      continue;
+
+    const uint8_t *pSelf = pLevel->grid + y * level::width;
+    const __m256i grown = level_growPlants_tiles(pSelf);
+
+    const uint32_t unchanged = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(grown, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pSelf))));
+
+    // The row above has been read for the last time.
+    writePendingRow();
+
+    if (unchanged != lsMaxValue<uint32_t>())
+    {
+      pendingRow = grown;
+      pendingY = y;
+      level_plant_growth_setRow(grownRows, y);
+      anyGrown = true;
+    }
   }
 
-  if (ret.values[vcp_nearRight] & tf_Collidable)
-    ret.values[vcp_midRight] = tf_Hidden;
+  writePendingRow();
 
-  // TODO: other actor flag
+  lsMemcpy(pGrowth->activeRows, grownRows, LS_ARRAYSIZE(grownRows));
 
-  return ret;
+  return anyGrown;
 }
 
-void viewCone_print(const viewCone &v, const actor &actor)
+//////////////////////////////////////////////////////////////////////////
+
+static_assert(level_regrowth::entryCount < level_regrowth::noEntry);
+
+void level_regrowth_init(level_regrowth *pRegrowth, const uint32_t delay /* = level_regrowth::defaultDelay */)
 {
-  print("VIEWCONE from pos ", actor.pos, " with look direction: ", lookDirection_name(actor.look_at_dir), '\n');
+  lsAssert(delay > 0 && delay <= level_regrowth::maxDelay);
 
-  printEmptyTile();        printTile(v[vcp_nearLeft]);    printTile(v[vcp_midLeft]);    print('\n');
-  printTile(v[vcp_self]);  printTile(v[vcp_nearCenter]);  printTile(v[vcp_midCenter]);  printTile(v[vcp_farCenter]);  print('\n');
-  printEmptyTile();        printTile(v[vcp_nearRight]);   printTile(v[vcp_midRight]);   print('\n');
-}
+  pRegrowth->delay = delay;
+  pRegrowth->currentStep = 0;
+  pRegrowth->pendingCount = 0;
 
-//////////////////////////////////////////////////////////////////////////
+  lsMemset(&pRegrowth->slots[0][0], level_regrowth::wheelCount * level_regrowth::slotCount, 0xFF);
+  lsZeroMemory(pRegrowth->pendingFood, LS_ARRAYSIZE(pRegrowth->pendingFood));
+}
 
-template <typename T>
-  requires (std::is_integral_v<T> && (sizeof(T) < sizeof(int64_t) || std::is_same_v<T, int64_t>))
-inline T modify_with_clamp(T &value, const int64_t diff, const T min = lsMinValue<T>(), const T max = lsMaxValue<T>())
+// Adds the entry to the lowest wheel that doesn't pass its slot before it's due.
+static void level_regrowth_insert(level_regrowth *pRegrowth, const uint32_t entry)
 {
-  const int64_t val = (int64_t)value + diff;
-  const T prevVal = value;
-  value = (T)lsClamp<int64_t>(val, min, max);
-  return value - prevVal;
+  const uint32_t dueStep = pRegrowth->due[entry];
+  lsAssert(dueStep - pRegrowth->currentStep <= level_regrowth::maxDelay);
+
+  size_t wheel = 0;
+
+  while (wheel < level_regrowth::wheelCount - 1 && (dueStep >> (level_regrowth::slotBits * (wheel + 1))) != (pRegrowth->currentStep >> (level_regrowth::slotBits * (wheel + 1))))
+    wheel++;
+
+  uint32_t *pHead = &pRegrowth->slots[wheel][(dueStep >> (level_regrowth::slotBits * wheel)) & (level_regrowth::slotCount - 1)];
+  pRegrowth->next[entry] = *pHead;
+  *pHead = entry;
 }
 
-void actor_act(actor *pActor, level *pLevel, const viewCone &cone, const actorAction action)
+void level_regrowth_scheduleAt_internal(level_regrowth *pRegrowth, const size_t tileIndex, const size_t foodIndex, const uint32_t dueStep)
 {
-  switch (action)
-  {
-  case aa_Move:
-    actor_move(pActor, *pLevel);
-    break;
+  lsAssert(tileIndex < level::total && foodIndex < level_regrowth::foodTypeCount);
 
-  case aa_Move2:
-    actor_moveTwo(pActor, *pLevel);
-    break;
+  const uint8_t food = (uint8_t)(1 << (foodIndex + _actorStats_FoodBegin));
 
-  case aa_TurnLeft:
-    actor_turnLeft(pActor);
-    break;
+  if (pRegrowth->pendingFood[tileIndex] & food)
+    return;
 
-  case aa_TurnRight:
-    actor_turnRight(pActor);
-    break;
+  const uint32_t entry = (uint32_t)(tileIndex * level_regrowth::foodTypeCount + foodIndex);
 
-  case aa_Eat:
-    actor_eat(pActor, pLevel, cone);
-    break;
+  pRegrowth->pendingFood[tileIndex] |= food;
+  pRegrowth->pendingCount++;
+  pRegrowth->due[entry] = dueStep;
 
-  default:
-    lsFail(); // not implemented.
-    break;
-  }
+  level_regrowth_insert(pRegrowth, entry);
 }
 
-void actor_updateStats(actor *pActor, const viewCone &cone)
+void level_regrowth_schedule(level_regrowth *pRegrowth, const size_t tileIndex, const tileFlag food)
 {
-  constexpr int64_t IdleEnergyCost = 2;
-
-  // Remove Idle Energy
-  modify_with_clamp(pActor->stats[as_Energy], -IdleEnergyCost);
+  lsAssert(food != 0 && (food & (food - 1)) == 0); // exactly one food type.
+  lsAssert(food >= tf_Protein && food <= tf_Fat);
 
-  // Check air
-  constexpr int64_t UnderwaterAirCost = 5;
-  constexpr int64_t SurfaceAirAmount = 3;
-  constexpr int64_t NoAirEnergyCost = 8;
+  level_regrowth_scheduleAt_internal(pRegrowth, tileIndex, (size_t)lsLowestBit((uint32_t)food) - _actorStats_FoodBegin, pRegrowth->currentStep + pRegrowth->delay);
+}
 
-  if (cone[vcp_self] & tf_Underwater)
-    modify_with_clamp(pActor->stats[as_Air], -UnderwaterAirCost);
-  else
-    modify_with_clamp(pActor->stats[as_Air], SurfaceAirAmount);
+size_t level_regrowth_advance(level_regrowth *pRegrowth, level *pLevel, level_undo_log *pUndoLog /* = nullptr */, level_plant_growth *pGrowth /* = nullptr */)
+{
+  pRegrowth->currentStep++;
 
-  if (!pActor->stats[as_Air])
-    modify_with_clamp(pActor->stats[as_Energy], -NoAirEnergyCost);
+  const uint32_t step = pRegrowth->currentStep;
 
-  // Digest
-  constexpr int64_t FoodEnergyAmount = 5;
-  constexpr int64_t FoodDigestionAmount = 1;
+  // Move the entries of the slots that were just reached in the upper wheels down, starting with the top wheel, so they can fall through multiple wheels at once.
+  for (size_t wheel = level_regrowth::wheelCount - 1; wheel > 0; wheel--)
+  {
+    if ((step & ((1U << (level_regrowth::slotBits * wheel)) - 1)) != 0)
+      continue;
 
-  size_t count = 0;
+    uint32_t *pHead = &pRegrowth->slots[wheel][(step >> (level_regrowth::slotBits * wheel)) & (level_regrowth::slotCount - 1)];
+    uint32_t entry = *pHead;
+    *pHead = level_regrowth::noEntry;
 
-  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
-  {
-    if (pActor->stats[i])
+    while (entry != level_regrowth::noEntry)
     {
-      modify_with_clamp(pActor->stats[i], -FoodDigestionAmount);
-      count++;
+      const uint32_t next = pRegrowth->next[entry];
+      level_regrowth_insert(pRegrowth, entry);
+      entry = next;
     }
   }
 
-  modify_with_clamp(pActor->stats[as_Energy], count * FoodEnergyAmount);
-}
+  uint32_t *pHead = &pRegrowth->slots[0][step & (level_regrowth::slotCount - 1)];
+  uint32_t entry = *pHead;
+  *pHead = level_regrowth::noEntry;
 
-void actor_move(actor *pActor, const level &lvl)
-{
-  constexpr int64_t MovementEnergyCost = 10;
-  constexpr int64_t CollideEnergyCost = 4;
-  constexpr vec2i16 lut[_lookDirection_Count] = { vec2i16(-1, 0), vec2i16(0, -1), vec2i16(1, 0), vec2i16(0, -1) };
+  size_t regrownCount = 0;
 
-  lsAssert(pActor->pos.x < level::width && pActor->pos.y < level::height);
-  lsAssert(!(lvl.grid[pActor->pos.y * level::width + pActor->pos.x] & tf_Collidable));
+  while (entry != level_regrowth::noEntry)
+  {
+    lsAssert(pRegrowth->due[entry] == step);
 
-  const size_t oldEnergy = pActor->stats[as_Energy];
-  modify_with_clamp(pActor->stats[as_Energy], -MovementEnergyCost);
+    const size_t tileIndex = entry / level_regrowth::foodTypeCount;
+    const uint8_t food = (uint8_t)(1 << (entry % level_regrowth::foodTypeCount + _actorStats_FoodBegin));
 
-  if (oldEnergy < MovementEnergyCost)
-    return;
+    if (!(pLevel->grid[tileIndex] & food))
+    {
+      if (pUndoLog != nullptr)
+        level_undo_log_record(pUndoLog, *pLevel, tileIndex);
 
-  const vec2u16 newPos = vec2u16(vec2i16(pActor->pos) + lut[pActor->look_at_dir]);
+      if (pGrowth != nullptr)
+        level_plant_growth_markTile(pGrowth, tileIndex);
+    }
 
-  if (lvl.grid[newPos.y * level::width + newPos.x] & tf_Collidable)
-  {
-    modify_with_clamp(pActor->stats[as_Energy], -CollideEnergyCost);
-    return;
+    pLevel->grid[tileIndex] |= food;
+    pRegrowth->pendingFood[tileIndex] &= ~food;
+
+    regrownCount++;
+    entry = pRegrowth->next[entry];
   }
 
-  pActor->pos = newPos;
-}
+  lsAssert(pRegrowth->pendingCount >= regrownCount);
+  pRegrowth->pendingCount -= regrownCount;
 
-void actor_moveTwo(actor *pActor, const level &lvl)
-{
-  constexpr int64_t DoubleMovementEnergyCost = 30;
-  constexpr int64_t CollideEnergyCost = 4;
-  constexpr vec2i16 LutDouble[_lookDirection_Count] = { vec2i16(-2, 0), vec2i16(0, -2), vec2i16(2, 0), vec2i16(0, -2) };
-  constexpr int8_t LutSingle[_lookDirection_Count] = { -1, -(int64_t)level::width, 1, level::width };
+  return regrownCount;
+}
 
-  lsAssert(pActor->pos.x < level::width && pActor->pos.y < level::height);
-  lsAssert(!(lvl.grid[pActor->pos.y * level::width + pActor->pos.x] & tf_Collidable));
+//////////////////////////////////////////////////////////////////////////
 
-  const size_t oldEnergy = pActor->stats[as_Energy];
-  modify_with_clamp(pActor->stats[as_Energy], DoubleMovementEnergyCost);
+void level_bitplanes_build(level_bitplanes *pPlanes, const level &lvl)
+{
+  static_assert(sizeof(__m256i) * 8 == 256 && level::total % sizeof(__m256i) == 0);
 
-  if (oldEnergy < DoubleMovementEnergyCost)
-    return;
+  uint32_t *pPlaneBits[LS_ARRAYSIZE(pPlanes->planes)];
 
-  const size_t nearIdx = (pActor->pos.y * level::width + pActor->pos.x) + LutSingle[pActor->look_at_dir];
-  const size_t newPosIdx = nearIdx + LutSingle[pActor->look_at_dir];
+  for (size_t bit = 0; bit < LS_ARRAYSIZE(pPlanes->planes); bit++)
+    pPlaneBits[bit] = reinterpret_cast<uint32_t *>(pPlanes->planes[bit].words);
 
-  if ((lvl.grid[newPosIdx] & tf_Collidable) || (lvl.grid[nearIdx] & tf_Collidable))
+  // Every bit is moved into the sign bit of the bytes in turn, `movemask` then collects 32 tiles at once.
+  for (size_t i = 0; i < level::total; i += sizeof(__m256i))
   {
-    modify_with_clamp(pActor->stats[as_Energy], -CollideEnergyCost);
-    return;
+    const __m256i tiles = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lvl.grid + i));
+
+    pPlaneBits[0][i / 32] = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(tiles, 7));
+    pPlaneBits[1][i / 32] = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(tiles, 6));
+    pPlaneBits[2][i / 32] = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(tiles, 5));
+    pPlaneBits[3][i / 32] = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(tiles, 4));
+    pPlaneBits[4][i / 32] = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(tiles, 3));
+    pPlaneBits[5][i / 32] = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(tiles, 2));
+    pPlaneBits[6][i / 32] = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi16(tiles, 1));
+    pPlaneBits[7][i / 32] = (uint32_t)_mm256_movemask_epi8(tiles);
   }
-
-  const vec2u16 newPos = vec2u16((vec2i16)(pActor->pos) + LutDouble[pActor->look_at_dir]);
-  pActor->pos = newPos;
 }
 
-constexpr int64_t TurnEnergy = 2;
-
-void actor_turnLeft(actor *pActor)
+void level_bitplanes_any(const level_bitplanes &planes, const tileFlag flags, level_bitplane *pOut)
 {
-  const size_t oldEnergy = pActor->stats[as_Energy];
-  modify_with_clamp(pActor->stats[as_Energy], TurnEnergy);
-
-  if (oldEnergy < TurnEnergy)
-    return;
+  lsZeroMemory(pOut);
 
-  pActor->look_at_dir = pActor->look_at_dir == ld_left ? ld_down : (lookDirection)(pActor->look_at_dir - 1);
-  lsAssert(pActor->look_at_dir < _lookDirection_Count);
+  for (size_t bit = 0; bit < LS_ARRAYSIZE(planes.planes); bit++)
+    if (flags & (1 << bit))
+      level_bitplane_or(*pOut, planes.planes[bit], pOut);
 }
 
-void actor_turnRight(actor *pActor)
+void level_bitplane_and(const level_bitplane &a, const level_bitplane &b, level_bitplane *pOut)
 {
-  const size_t oldEnergy = pActor->stats[as_Energy];
-  modify_with_clamp(pActor->stats[as_Energy], TurnEnergy);
-
-  if (oldEnergy < TurnEnergy)
-    return;
-
-  pActor->look_at_dir = pActor->look_at_dir == ld_down ? ld_left : (lookDirection)(pActor->look_at_dir + 1);
-  lsAssert(pActor->look_at_dir < _lookDirection_Count);
+  for (size_t i = 0; i < level_bitplane::word_count; i += sizeof(__m256i) / sizeof(uint64_t))
+    _mm256_store_si256(reinterpret_cast<__m256i *>(pOut->words + i), _mm256_and_si256(_mm256_load_si256(reinterpret_cast<const __m256i *>(a.words + i)), _mm256_load_si256(reinterpret_cast<const __m256i *>(b.words + i))));
 }
 
-void actor_eat(actor *pActor, level *pLvl, const viewCone &cone)
+void level_bitplane_or(const level_bitplane &a, const level_bitplane &b, level_bitplane *pOut)
 {
-  static constexpr int64_t EatEnergyCost = 3;
-  static constexpr int64_t FoodAmount = 2;
-  static constexpr uint8_t StomachCapacity = 255;
-
-  lsAssert(pActor->pos.x < level::width && pActor->pos.y < level::height);
-
-  const size_t oldEnergy = pActor->stats[as_Energy];
-  modify_with_clamp(pActor->stats[as_Energy], EatEnergyCost);
+  for (size_t i = 0; i < level_bitplane::word_count; i += sizeof(__m256i) / sizeof(uint64_t))
+    _mm256_store_si256(reinterpret_cast<__m256i *>(pOut->words + i), _mm256_or_si256(_mm256_load_si256(reinterpret_cast<const __m256i *>(a.words + i)), _mm256_load_si256(reinterpret_cast<const __m256i *>(b.words + i))));
+}
 
-  if (oldEnergy < TurnEnergy)
-    return;
+void level_bitplane_andNot(const level_bitplane &a, const level_bitplane &notB, level_bitplane *pOut)
+{
+  for (size_t i = 0; i < level_bitplane::word_count; i += sizeof(__m256i) / sizeof(uint64_t))
+    _mm256_store_si256(reinterpret_cast<__m256i *>(pOut->words + i), _mm256_andnot_si256(_mm256_load_si256(reinterpret_cast<const __m256i *>(notB.words + i)), _mm256_load_si256(reinterpret_cast<const __m256i *>(a.words + i))));
+}
 
-  size_t stomachFoodCount = 0;
+// Moves every tile `shift` tiles towards higher (positive) or lower (negative) tile indices, tiles that are moved out of the level are dropped.
+static void level_bitplane_shift(const level_bitplane &plane, const int64_t shift, level_bitplane *pOut)
+{
+  const size_t distance = (size_t)(shift < 0 ? -shift : shift);
+  const size_t wordShift = distance / 64;
+  const size_t bitShift = distance % 64;
 
-  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
-    stomachFoodCount += pActor->stats[i];
+  for (size_t i = 0; i < level_bitplane::word_count; i++)
+  {
+    uint64_t value = 0;
 
-  lsAssert(stomachFoodCount <= StomachCapacity);
+    if (shift >= 0)
+    {
+      if (i >= wordShift)
+        value = plane.words[i - wordShift] << bitShift;
 
-  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
-  {
-    if (cone[vcp_self] & (1ULL << i))
+      if (bitShift != 0 && i >= wordShift + 1)
+        value |= plane.words[i - wordShift - 1] >> (64 - bitShift);
+    }
+    else
     {
-      stomachFoodCount += modify_with_clamp(pActor->stats[i], FoodAmount, lsMinValue<uint8_t>(), (uint8_t)((StomachCapacity - stomachFoodCount) + pActor->stats[i]));
-      pLvl->grid[pActor->pos.y * level::width + pActor->pos.x] &= ~(1ULL << i);
+      if (i + wordShift < level_bitplane::word_count)
+        value = plane.words[i + wordShift] >> bitShift;
+
+      if (bitShift != 0 && i + wordShift + 1 < level_bitplane::word_count)
+        value |= plane.words[i + wordShift + 1] << (64 - bitShift);
     }
+
+    pOut->words[i] = value;
   }
 }
 
-//////////////////////////////////////////////////////////////////////////
-
-struct proto_chance_config
-{
-  static constexpr uint64_t chanceOf1024 = 12;
-};
-
-struct proto_config // TODO!
+static constexpr level_bitplane level_bitplane_column(const size_t x)
 {
-  using mutator = mutator_chance<proto_chance_config>; // ?
-  using crossbreeder = crossbreeder_naive;
+  level_bitplane plane{};
 
-  static constexpr size_t survivingGenes = 4;
-  static constexpr size_t newGenesPerGeneration = 4;
-};
+  for (size_t y = 0; y < level::height; y++)
+    plane.words[(y * level::width + x) / 64] |= 1ULL << ((y * level::width + x) % 64);
 
-template <typename crossbreeder>
-void crossbreed(actor &val, const actor parentA, const actor parentB, const crossbreeder &c)
-{
-  crossbreeder_eval(c, &val.brain.values, &parentA.brain.values, &parentB.brain.values);
+  return plane;
 }
 
-template <typename mutator>
-void mutate(actor &target, const mutator &m)
+void level_bitplane_neighbours(const level_bitplane &plane, level_bitplane *pOut)
 {
-  mutator_eval(m, &target.brain.values, LS_ARRAYSIZE(target.brain.values), lsMinValue<uint8_t>(), lsMaxValue<uint8_t>());
+  static constexpr level_bitplane firstColumn = level_bitplane_column(0);
+  static constexpr level_bitplane lastColumn = level_bitplane_column(level::width - 1);
+
+  level_bitplane shifted;
+
+  // Tiles that wrapped into the next / previous row are removed.
+  level_bitplane_shift(plane, 1, &shifted);
+  level_bitplane_andNot(shifted, firstColumn, pOut);
+
+  level_bitplane_shift(plane, -1, &shifted);
+  level_bitplane_andNot(shifted, lastColumn, &shifted);
+  level_bitplane_or(*pOut, shifted, pOut);
+
+  level_bitplane_shift(plane, (int64_t)level::width, &shifted);
+  level_bitplane_or(*pOut, shifted, pOut);
+
+  level_bitplane_shift(plane, -(int64_t)level::width, &shifted);
+  level_bitplane_or(*pOut, shifted, pOut);
 }
 
-// TODO: Eval Funcs... -> Give scores
+size_t level_bitplane_count(const level_bitplane &plane)
+{
+  size_t count = 0;
 
-//////////////////////////////////////////////////////////////////////////
+  for (size_t i = 0; i < level_bitplane::word_count; i++)
+    count += (size_t)std::popcount(plane.words[i]);
 
-#include <time.h>
+  return count;
+}
 
-lsResult save_brain(const char *dir, const actor &actr)
+// Writes the view cone bits (as `lsMaxValue<int8_t>()` or 0, just like `neural_net_buffer_prepare` would) and the stats (centered around 0) into the input blocks of `ioBuffer`.
+inline static void actor_encodeInputs(decltype(actor::brain)::io_buffer_t &ioBuffer, const viewCone &cone, const uint8_t(&stats)[_actorStats_Count])
 {
-  lsResult result = lsR_Success;
+  constexpr size_t coneBitsPerBlock = decltype(actor::brain)::io_buffer_t::block_size;
+  constexpr size_t coneBlockCount = (_viewConePosition_Count * 8) / coneBitsPerBlock;
 
-  const uint64_t now = (uint64_t)time(nullptr);
-  char filename[256];
-  sformat_to(filename, LS_ARRAYSIZE(filename), dir, "/", now, ".brain");
+  static_assert(coneBitsPerBlock == sizeof(uint16_t) * 8);
+  static_assert(sizeof(viewCone::values) == sizeof(uint64_t));
+  static_assert(_actorStats_Count <= sizeof(uint64_t) && _actorStats_Count <= coneBitsPerBlock);
+  static_assert(sizeof(decltype(actor::brain)::io_buffer_t::data) >= (coneBlockCount + 1) * sizeof(__m256i));
 
-  print("Saving brain to file: '", filename, '\n');
+  __m256i *pBuffer = reinterpret_cast<__m256i *>(ioBuffer.data);
 
-  {
-    cached_file_byte_stream_writer<> write_stream;
-    LS_ERROR_CHECK(write_byte_stream_init(write_stream, filename));
-    value_writer<decltype(write_stream)> writer;
-    LS_ERROR_CHECK(value_writer_init(writer, &write_stream));
+  uint64_t coneBits;
+  memcpy(&coneBits, cone.values, sizeof(coneBits));
 
-    LS_ERROR_CHECK(neural_net_write(actr.brain, writer));
-    LS_ERROR_CHECK(write_byte_stream_flush(write_stream));
+  // Broadcast two cone tiles into every lane and keep the bit that belongs to the lane.
+  const __m256i bits = _mm256_setr_epi16(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7, 1 << 8, 1 << 9, 1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14, (int16_t)(1 << 15));
+  const __m256i one = _mm256_set1_epi16(lsMaxValue<int8_t>());
+
+  for (size_t i = 0; i < coneBlockCount; i++)
+  {
+    const __m256i tiles = _mm256_set1_epi16((int16_t)(coneBits >> (i * coneBitsPerBlock)));
+    _mm256_store_si256(pBuffer + i, _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_and_si256(tiles, bits), bits), one));
   }
 
-epilogue:
-  return result;
+  // All stats in one go, the remainder of the block is zeroed.
+  uint64_t packedStats = 0;
+  memcpy(&packedStats, stats, sizeof(stats));
+
+  const __m256i statCenter = _mm256_set1_epi16(128);
+  const __m256i statLanes = _mm256_cmpgt_epi16(_mm256_set1_epi16(_actorStats_Count), _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+  const __m256i centered = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_cvtsi64_si128((int64_t)packedStats)), _mm256_and_si256(statCenter, statLanes));
+
+  _mm256_store_si256(pBuffer + coneBlockCount, centered);
 }
 
-lsResult load_brain_from_file(const char *filename, actor &actr)
+actorAction actor_chooseAction(const decltype(actor::brain) &brain, const viewCone &cone, const uint8_t(&stats)[_actorStats_Count])
 {
-  lsResult result = lsR_Success;
+  decltype(actor::brain)::io_buffer_t ioBuffer;
 
-  print("Loading brain from file: ", filename, '\n');
+  actor_encodeInputs(ioBuffer, cone, stats);
 
-  cached_file_byte_stream_reader<> read_stream;
-  value_reader<cached_file_byte_stream_reader<>> reader;
-  LS_ERROR_CHECK(read_byte_stream_init(read_stream, filename));
-  LS_ERROR_CHECK(value_reader_init(reader, &read_stream));
+  neural_net_eval(brain, ioBuffer);
 
-  LS_ERROR_CHECK(neural_net_read(actr.brain, reader));
-  read_byte_stream_destroy(read_stream);
+  int16_t maxValue = ioBuffer.data[0];
+  size_t bestActionIndex = 0;
+  constexpr size_t maxActionIndex = lsMin(LS_ARRAYSIZE(ioBuffer.data), _actorAction_Count);
 
-epilogue:
-  return result;
+  for (size_t actionIndex = 1; actionIndex < maxActionIndex; actionIndex++)
+  {
+    if (maxValue < ioBuffer.data[actionIndex])
+    {
+      maxValue = ioBuffer.data[actionIndex];
+      bestActionIndex = actionIndex;
+    }
+  }
+
+  return (actorAction)bestActionIndex;
 }
 
-lsResult load_newest_brain(const char *dir, actor &actr)
+template <typename rules, typename level_type>
+size_t level_performStep(level_type &lvl, actor *pActors, const size_t actorCount, const std::type_identity_t<level_step_options_t<level_type>> &options)
 {
-  lsResult result = lsR_Success;
+  if constexpr (std::is_same_v<level_type, level>)
+  {
+    if (options.pGrowth != nullptr)
+      level_growPlants(&lvl, options.pGrowth, options.pUndoLog);
 
-  const std::filesystem::path path(dir);
+    if (options.pRegrowth != nullptr)
+      level_regrowth_advance(options.pRegrowth, &lvl, options.pUndoLog, options.pGrowth);
+  }
 
-  int64_t bestTime = -1;
-  std::string best;
+  // The occupancy of large levels doesn't fit on the stack, so the caller has to provide one. A single actor can't run into others, so it doesn't need one at all.
+  constexpr bool largeOccupancy = sizeof(level_occupancy_t<level_type>) > 64 * 1024;
 
-  for (const std::filesystem::directory_entry &dir_entry : std::filesystem::directory_iterator(dir))
+  level_occupancy_t<level_type> *pOccupancy = options.pOccupancy;
+  std::conditional_t<largeOccupancy, uint8_t, level_occupancy_t<level_type>> stackOccupancy;
+
+  if constexpr (largeOccupancy)
   {
-    if (dir_entry.is_regular_file())
+    lsAssert(pOccupancy != nullptr || actorCount <= 1);
+  }
+  else
+  {
+    if (pOccupancy == nullptr)
     {
-      const std::filesystem::file_time_type &timestamp = dir_entry.last_write_time();
-      const int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
-
-      if (bestTime < timeMs)
-      {
-        bestTime = timeMs;
-        best = dir_entry.path().filename().string();
-      }
+      pOccupancy = &stackOccupancy;
+      level_occupancy_clear(pOccupancy);
     }
   }
 
-  lsAssert(bestTime >= 0);
-  LS_ERROR_CHECK(load_brain_from_file(best.c_str(), actr));
+  size_t aliveCount = 0;
 
-epilogue:
-  return result;
-}
+  if (pOccupancy != nullptr)
+    for (size_t i = 0; i < actorCount; i++)
+      if (pActors[i].stats[as_Energy])
+        level_occupancy_add(pOccupancy, pActors[i].pos);
 
-// load specific brain: list and then select in console
+  for (size_t i = 0; i < actorCount; i++)
+  {
+    if (!pActors[i].stats[as_Energy])
+      continue;
 
-// train: load actor, start training, save actor whilst training, reevaluate scores... save
+    const viewCone cone = viewCone_get<viewCone_shape_default, level_type>(lvl, pActors[i].pos, pActors[i].look_at_dir, pOccupancy);
+    actor_updateStats<rules>(&pActors[i], cone);
+
+    const actorAction action = actor_chooseAction(pActors[i].brain, cone, pActors[i].stats);
+    actor_act<rules, level_type>(&pActors[i], &lvl, cone, action, pOccupancy, &options);
+
+    if (pActors[i].stats[as_Energy])
+      aliveCount++;
+    else if (pOccupancy != nullptr)
+      level_occupancy_remove(pOccupancy, pActors[i].pos);
+  }
+
+  // Leave the caller's occupancy empty for the next step, that's cheaper than clearing the whole level.
+  if (options.pOccupancy != nullptr)
+    for (size_t i = 0; i < actorCount; i++)
+      if (pActors[i].stats[as_Energy])
+        level_occupancy_remove(pOccupancy, pActors[i].pos);
+
+  return aliveCount;
+}
+
+// Phase one of the population step: only touches the actors `[first, end)` and reads the level, so ranges can be processed concurrently.
+// If `pReplayedActions` is provided, the actions are taken from there instead of evaluating the brains.
+template <typename rules>
+static void level_performStep_decide(const level &lvl, actor_population *pActors, const size_t first, const size_t end, const uint8_t *pReplayedActions)
+{
+  constexpr size_t blockSize = actor_population::capacity_granularity;
+
+  for (size_t block = first; block < end; block += blockSize)
+  {
+    uint32_t alive = pActors->pAliveBits[block / blockSize];
+
+    if (alive == 0)
+      continue;
+
+    const size_t blockEnd = lsMin(block + blockSize, end);
+
+    viewCone_get_many(lvl, pActors->pOccupancy, pActors->pPos + block, pActors->pLookDir + block, blockEnd - block, pActors->pCones + block);
+    actor_updateStats_range<rules>(pActors, pActors->pCones, block, blockEnd);
+
+    if (pReplayedActions != nullptr)
+    {
+      for (; alive != 0; alive &= alive - 1)
+      {
+        const size_t i = block + lsLowestBit(alive);
+        pActors->pActions[i] = pReplayedActions[i];
+      }
+
+      continue;
+    }
+
+    for (; alive != 0; alive &= alive - 1)
+    {
+      const size_t i = block + lsLowestBit(alive);
+
+      uint8_t stats[_actorStats_Count];
+
+      for (size_t j = 0; j < _actorStats_Count; j++)
+        stats[j] = pActors->pStats[j][i];
+
+      pActors->pActions[i] = (uint8_t)actor_chooseAction(pActors->pBrains[i], pActors->pCones[i], stats);
+    }
+  }
+}
+
+template <typename rules>
+size_t level_performStep(level &lvl, actor_population *pActors, thread_pool *pThreadPool, const level_step_options &options)
+{
+  // The keyframes are taken before anything is changed.
+  if (options.pReplay != nullptr)
+    level_replay_writer_beginStep(options.pReplay, lvl, *pActors, options, actor_rules_tag<rules>());
+
+  if (options.pGrowth != nullptr)
+    level_growPlants(&lvl, options.pGrowth, options.pUndoLog);
+
+  if (options.pRegrowth != nullptr)
+    level_regrowth_advance(options.pRegrowth, &lvl, options.pUndoLog, options.pGrowth);
+
+  // Phase one: sample the cones, update the stats and evaluate the brains of all actors. Nothing in here depends on the order of the actors.
+  {
+    constexpr size_t minActorsPerTask = 256;
+    const size_t threadCount = thread_pool_thread_count(pThreadPool);
+    const size_t actorsPerTask = lsMax(minActorsPerTask, ((pActors->count / (threadCount * 4) + actor_population::capacity_granularity - 1) / actor_population::capacity_granularity) * actor_population::capacity_granularity);
+
+    if (pThreadPool == nullptr || pActors->count <= actorsPerTask)
+    {
+      level_performStep_decide<rules>(lvl, pActors, 0, pActors->count, options.pReplayedActions);
+    }
+    else
+    {
+      for (size_t first = 0; first < pActors->count; first += actorsPerTask)
+      {
+        const size_t end = lsMin(first + actorsPerTask, pActors->count);
+        const uint8_t *pReplayedActions = options.pReplayedActions;
+        thread_pool_add(pThreadPool, [&lvl, pActors, first, end, pReplayedActions]() { level_performStep_decide<rules>(lvl, pActors, first, end, pReplayedActions); });
+      }
+
+      thread_pool_await(pThreadPool);
+    }
+  }
+
+  if (options.pReplay != nullptr)
+    level_replay_writer_endStep(options.pReplay, *pActors);
+
+  // Phase two: apply the actions in actor order. If multiple actors want the same tile, the lowest id claims it (tiles that were occupied at the start of the step stay blocked), if multiple actors eat from the same tile, the lowest id gets the food.
+  level_occupancy claims = *pActors->pOccupancy;
+
+  for (size_t block = 0; block < pActors->count; block += actor_population::capacity_granularity)
+  {
+    for (uint32_t alive = pActors->pAliveBits[block / actor_population::capacity_granularity]; alive != 0; alive &= alive - 1)
+    {
+      const size_t i = block + lsLowestBit(alive);
+
+      actor_state state = actor_population_getState(*pActors, i);
+      viewCone cone = pActors->pCones[i];
+
+      // Another actor may have eaten from this tile since the cone was sampled.
+      cone.values[vcp_self] = (cone.values[vcp_self] & tf_OtherActor) | lvl.grid[state.pos.y * level::width + state.pos.x];
+
+      const vec2u16 oldPos = state.pos;
+      actor_act<rules>(&state, &lvl, cone, (actorAction)pActors->pActions[i], &claims, &options);
+      actor_population_setState(pActors, i, state);
+
+      if (oldPos != state.pos)
+      {
+        level_occupancy_add(&claims, oldPos); // `actor_act` released the old tile, but it stays blocked until the next step.
+
+        level_occupancy_remove(pActors->pOccupancy, oldPos);
+        level_occupancy_add(pActors->pOccupancy, state.pos);
+      }
+
+      if (!state.stats[as_Energy])
+      {
+        level_occupancy_remove(pActors->pOccupancy, state.pos);
+        actor_population_markDead(pActors, i);
+      }
+    }
+  }
+
+  return pActors->aliveCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+constexpr int32_t viewCone_width = (int32_t)level::width;
+
+constexpr const auto &viewCone_tileOffset = viewCone_layout_of<viewCone_shape_default>.tileOffset;
+
+// Hidden tiles for every combination of collidable tiles in a cone: bit `i` of the index is set if `values[i]` is collidable, byte `i` of the entry is `0xFF` if `values[i]` ends up hidden.
+struct viewCone_hiddenLut
+{
+  uint64_t masks[1 << _viewConePosition_Count];
+
+  constexpr viewCone_hiddenLut() : masks()
+  {
+    constexpr const viewCone_layout<viewCone_shape_default> &layout = viewCone_layout_of<viewCone_shape_default>;
+
+    for (size_t pattern = 0; pattern < LS_ARRAYSIZE(masks); pattern++)
+    {
+      uint64_t mask = 0;
+
+      for (size_t i = 0; i < layout.count; i++)
+        if (pattern & layout.occluders[i])
+          mask |= 0xFFULL << (i * 8);
+
+      masks[pattern] = mask;
+    }
+  }
+};
+
+constexpr viewCone_hiddenLut viewCone_hidden;
+
+static_assert(sizeof(viewCone) == sizeof(uint64_t) && _viewConePosition_Count == 8);
+static_assert(tf_Collidable == 1 << 5 && tf_Hidden == 1 << 7); // the collidable bit is moved into the sign bit of each byte.
+
+// Gathers the view cones of 8 actors. `tileIndex` is in bytes, relative to `pGridBase`. Lanes not set in `mask` don't touch the grid and produce empty cones.
+// If `pActorCounts` is provided, it's indexed with the same `tileIndex` to set `tf_OtherActor`.
+inline static void viewCone_gather8(const int32_t *pGridBase, const uint16_t *pActorCounts, const __m256i tileIndex, const __m256i dir, const __m256i mask, viewCone *pOut)
+{
+  __m256i halves[2] = { _mm256_setzero_si256(), _mm256_setzero_si256() }; // `vcp_self` .. `vcp_nearRight`, `vcp_midLeft` .. `vcp_farCenter` of each actor.
+
+  for (size_t i = 0; i < _viewConePosition_Count; i++)
+  {
+    const __m256i offsetByDir = _mm256_setr_epi32(viewCone_tileOffset[ld_left][i], viewCone_tileOffset[ld_up][i], viewCone_tileOffset[ld_right][i], viewCone_tileOffset[ld_down][i], 0, 0, 0, 0);
+    const __m256i index = _mm256_add_epi32(tileIndex, _mm256_permutevar8x32_epi32(offsetByDir, dir));
+    __m256i value = _mm256_and_si256(_mm256_mask_i32gather_epi32(_mm256_setzero_si256(), pGridBase, index, mask, 1), _mm256_set1_epi32(0xFF));
+
+    if (pActorCounts != nullptr)
+    {
+      const __m256i actorCount = _mm256_and_si256(_mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int32_t *>(pActorCounts), index, mask, sizeof(uint16_t)), _mm256_set1_epi32(0xFFFF));
+      const __m256i otherActor = _mm256_cmpgt_epi32(actorCount, _mm256_set1_epi32(i == vcp_self ? 1 : 0)); // don't count the actor itself.
+
+      value = _mm256_or_si256(value, _mm256_and_si256(otherActor, _mm256_set1_epi32(tf_OtherActor)));
+    }
+
+    halves[i / 4] = _mm256_or_si256(halves[i / 4], _mm256_sllv_epi32(value, _mm256_set1_epi32((int32_t)((i % 4) * 8))));
+  }
+
+  // Interleave into one 64 bit cone per actor, restoring the actor order across the 128 bit lanes.
+  const __m256i unpackedLow = _mm256_unpacklo_epi32(halves[0], halves[1]); // actors 0, 1, 4, 5
+  const __m256i unpackedHigh = _mm256_unpackhi_epi32(halves[0], halves[1]); // actors 2, 3, 6, 7
+
+  const __m256i cones[2] = { _mm256_permute2x128_si256(unpackedLow, unpackedHigh, 0x20), _mm256_permute2x128_si256(unpackedLow, unpackedHigh, 0x31) };
+  const __m256i hidden = _mm256_set1_epi8((char)tf_Hidden);
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(cones); i++)
+  {
+    // One collidable-pattern byte per cone.
+    const uint32_t patterns = (uint32_t)_mm256_movemask_epi8(_mm256_slli_epi64(cones[i], 2));
+    const __m256i hiddenMask = _mm256_i32gather_epi64(reinterpret_cast<const long long *>(viewCone_hidden.masks), _mm_cvtepu8_epi32(_mm_cvtsi32_si128((int32_t)patterns)), sizeof(uint64_t));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(pOut + i * 4), _mm256_blendv_epi8(cones[i], hidden, hiddenMask));
+  }
+}
+
+// Extracts `vcp_self` of 32 cones into one byte per cone.
+inline static __m256i viewCone_gatherSelf32(const viewCone *pCones)
+{
+  static_assert(vcp_self == 0);
+
+  const __m256i coneStride = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i selfTiles[4];
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(selfTiles); i++)
+    selfTiles[i] = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int32_t *>(pCones + i * 8), coneStride, sizeof(viewCone)), _mm256_set1_epi32(0xFF));
+
+  const __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(selfTiles[0], selfTiles[1]), _mm256_packus_epi32(selfTiles[2], selfTiles[3]));
+  return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+void viewCone_get_many(const level &lvl, const level_occupancy *pOccupancy, const vec2u16 *pPos, const uint8_t *pLookDir, const size_t count, viewCone *pOut)
+{
+  constexpr size_t groupLanes = sizeof(__m256i) / sizeof(int32_t);
+
+  static_assert(sizeof(vec2u16) == sizeof(int32_t));
+
+  // Gathers load 4 bytes per tile. The view cone never reaches past the last row of the level, so the 3 trailing bytes stay inside of it.
+  static_assert(level::wallThickness >= 3);
+
+  const int32_t *pGridBase = reinterpret_cast<const int32_t *>(lvl.grid);
+  const uint16_t *pActorCounts = pOccupancy != nullptr ? pOccupancy->count : nullptr;
+  const __m256i width = _mm256_set1_epi32((int32_t)level::width);
+  const __m256i lowWord = _mm256_set1_epi32(0xFFFF);
+
+  size_t i = 0;
+
+  for (; i + groupLanes <= count; i += groupLanes)
+  {
+    const __m256i pos = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pPos + i));
+    const __m256i dir = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pLookDir + i)));
+    const __m256i tileIndex = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(pos, 16), width), _mm256_and_si256(pos, lowWord));
+
+    viewCone_gather8(pGridBase, pActorCounts, tileIndex, dir, _mm256_set1_epi32(-1), pOut + i);
+  }
+
+  if (i < count)
+  {
+    const size_t remaining = count - i;
+
+    LS_ALIGN(32) vec2u16 pos[groupLanes];
+    uint8_t dir[groupLanes] = {};
+    viewCone cones[groupLanes];
+
+    lsZeroMemory(pos, groupLanes);
+    lsMemcpy(pos, pPos + i, remaining);
+    lsMemcpy(dir, pLookDir + i, remaining);
+
+    const __m256i posV = _mm256_load_si256(reinterpret_cast<const __m256i *>(pos));
+    const __m256i dirV = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(dir)));
+    const __m256i tileIndex = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(posV, 16), width), _mm256_and_si256(posV, lowWord));
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32((int32_t)remaining), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    viewCone_gather8(pGridBase, pActorCounts, tileIndex, dirV, mask, cones);
+    lsMemcpy(pOut + i, cones, remaining);
+  }
+}
+
+viewCone viewCone_get(const level &lvl, const actor &a)
+{
+  return viewCone_get(lvl, a.pos, a.look_at_dir);
+}
+
+viewCone viewCone_get(const level &lvl, const vec2u16 pos, const lookDirection dir, const level_occupancy *pOccupancy)
+{
+  return viewCone_get<viewCone_shape_default>(lvl, pos, dir, pOccupancy);
+}
+
+void viewCone_print(const viewCone &v, const actor &actor)
+{
+  print("VIEWCONE from pos ", actor.pos, " with look direction: ", lookDirection_name(actor.look_at_dir), '\n');
+
+  printEmptyTile();        printTile(v[vcp_nearLeft]);    printTile(v[vcp_midLeft]);    print('\n');
+  printTile(v[vcp_self]);  printTile(v[vcp_nearCenter]);  printTile(v[vcp_midCenter]);  printTile(v[vcp_farCenter]);  print('\n');
+  printEmptyTile();        printTile(v[vcp_nearRight]);   printTile(v[vcp_midRight]);   print('\n');
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+  requires (std::is_integral_v<T> && (sizeof(T) < sizeof(int64_t) || std::is_same_v<T, int64_t>))
+inline T modify_with_clamp(T &value, const int64_t diff, const T min = lsMinValue<T>(), const T max = lsMaxValue<T>())
+{
+  const int64_t val = (int64_t)value + diff;
+  const T prevVal = value;
+  value = (T)lsClamp<int64_t>(val, min, max);
+  return value - prevVal;
+}
+
+template <typename rules, typename level_type>
+void actor_act(actor_state *pActor, level_type *pLevel, const viewCone &cone, const actorAction action, std::type_identity_t<level_occupancy_t<level_type>> *pOccupancy, const std::type_identity_t<level_step_options_t<level_type>> *pOptions)
+{
+  const vec2u16 oldPos = pActor->pos;
+
+  switch (action)
+  {
+  case aa_Move:
+    actor_move<rules, level_type>(pActor, *pLevel, pOccupancy);
+    break;
+
+  case aa_Move2:
+    actor_moveTwo<rules, level_type>(pActor, *pLevel, pOccupancy);
+    break;
+
+  case aa_TurnLeft:
+    actor_turnLeft<rules>(pActor);
+    break;
+
+  case aa_TurnRight:
+    actor_turnRight<rules>(pActor);
+    break;
+
+  case aa_Eat:
+    actor_eat<rules, level_type>(pActor, pLevel, cone, pOptions);
+    break;
+
+  default:
+    lsFail(); // not implemented.
+    break;
+  }
+
+  if (pOccupancy != nullptr && oldPos != pActor->pos)
+  {
+    level_occupancy_remove(pOccupancy, oldPos);
+    level_occupancy_add(pOccupancy, pActor->pos);
+  }
+}
+
+template <typename rules>
+void actor_updateStats(actor_state *pActor, const viewCone &cone)
+{
+  // Remove Idle Energy
+  modify_with_clamp(pActor->stats[as_Energy], -rules::IdleEnergyCost);
+
+  // Check air
+  if (cone[vcp_self] & tf_Underwater)
+    modify_with_clamp(pActor->stats[as_Air], -rules::UnderwaterAirCost);
+  else
+    modify_with_clamp(pActor->stats[as_Air], rules::SurfaceAirAmount);
+
+  if (!pActor->stats[as_Air])
+    modify_with_clamp(pActor->stats[as_Energy], -rules::NoAirEnergyCost);
+
+  // Digest
+  size_t count = 0;
+
+  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
+  {
+    if (pActor->stats[i])
+    {
+      modify_with_clamp(pActor->stats[i], -rules::FoodDigestionAmount);
+      count++;
+    }
+  }
+
+  modify_with_clamp(pActor->stats[as_Energy], count * rules::FoodEnergyAmount);
+}
+
+// Updates the stats of 32 actors at once, following the rules of the scalar `actor_updateStats`. Lanes not set in `alive` are left untouched.
+template <typename rules>
+inline static void actor_updateStats_block(uint8_t *(&pStats)[_actorStats_Count], const size_t offset, const __m256i selfTiles, const __m256i alive)
+{
+  static_assert(rules::IdleEnergyCost >= 0 && rules::IdleEnergyCost <= lsMaxValue<uint8_t>() && rules::NoAirEnergyCost >= 0 && rules::NoAirEnergyCost <= lsMaxValue<uint8_t>());
+  static_assert(rules::SurfaceAirAmount >= 0 && rules::SurfaceAirAmount <= lsMaxValue<uint8_t>() && rules::UnderwaterAirCost >= 0 && rules::UnderwaterAirCost <= lsMaxValue<uint8_t>());
+  static_assert(rules::FoodDigestionAmount >= 0 && rules::FoodDigestionAmount <= lsMaxValue<uint8_t>() && rules::FoodEnergyAmount >= 0);
+
+  const __m256i zero = _mm256_setzero_si256();
+
+  const __m256i energy = _mm256_load_si256(reinterpret_cast<const __m256i *>(pStats[as_Energy] + offset));
+  const __m256i air = _mm256_load_si256(reinterpret_cast<const __m256i *>(pStats[as_Air] + offset));
+
+  __m256i newEnergy = _mm256_subs_epu8(energy, _mm256_set1_epi8((char)rules::IdleEnergyCost));
+
+  const __m256i underwater = _mm256_cmpeq_epi8(_mm256_and_si256(selfTiles, _mm256_set1_epi8(tf_Underwater)), _mm256_set1_epi8(tf_Underwater));
+  const __m256i newAir = _mm256_blendv_epi8(_mm256_adds_epu8(air, _mm256_set1_epi8((char)rules::SurfaceAirAmount)), _mm256_subs_epu8(air, _mm256_set1_epi8((char)rules::UnderwaterAirCost)), underwater);
+
+  const __m256i noAir = _mm256_cmpeq_epi8(newAir, zero);
+  newEnergy = _mm256_subs_epu8(newEnergy, _mm256_and_si256(noAir, _mm256_set1_epi8((char)rules::NoAirEnergyCost)));
+
+  __m256i foodCount = zero;
+
+  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
+  {
+    __m256i *pFood = reinterpret_cast<__m256i *>(pStats[i] + offset);
+    const __m256i food = _mm256_load_si256(pFood);
+
+    foodCount = _mm256_add_epi8(foodCount, _mm256_andnot_si256(_mm256_cmpeq_epi8(food, zero), _mm256_set1_epi8(1)));
+    _mm256_store_si256(pFood, _mm256_blendv_epi8(food, _mm256_subs_epu8(food, _mm256_set1_epi8((char)rules::FoodDigestionAmount)), alive));
+  }
+
+  static_assert((_actorStats_FoodEnd - _actorStats_FoodBegin + 1) * rules::FoodEnergyAmount <= lsMaxValue<int8_t>());
+  const __m256i foodEnergy = _mm256_mullo_epi16(foodCount, _mm256_set1_epi16((int16_t)rules::FoodEnergyAmount)); // small enough to never carry into the neighbouring byte.
+  newEnergy = _mm256_adds_epu8(newEnergy, foodEnergy);
+
+  _mm256_store_si256(reinterpret_cast<__m256i *>(pStats[as_Energy] + offset), _mm256_blendv_epi8(energy, newEnergy, alive));
+  _mm256_store_si256(reinterpret_cast<__m256i *>(pStats[as_Air] + offset), _mm256_blendv_epi8(air, newAir, alive));
+}
+
+// Updates the stats of the actors `[first, end)`. `first` has to be a multiple of the block size.
+template <typename rules>
+static void actor_updateStats_range(actor_population *pPopulation, const viewCone *pCones, const size_t first, const size_t end)
+{
+  constexpr size_t blockSize = sizeof(__m256i);
+  static_assert(actor_population::capacity_granularity % blockSize == 0);
+
+  lsAssert(first % blockSize == 0 && end <= pPopulation->count);
+
+  const __m256i laneIndex = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31);
+
+  for (size_t offset = first; offset < end; offset += blockSize)
+  {
+    const __m256i self = viewCone_gatherSelf32(pCones + offset);
+
+    // Only actors that are in the range and still have energy left.
+    const __m256i inPopulation = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)lsMin(end - offset, blockSize)), laneIndex);
+    const __m256i energy = _mm256_load_si256(reinterpret_cast<const __m256i *>(pPopulation->pStats[as_Energy] + offset));
+    const __m256i alive = _mm256_andnot_si256(_mm256_cmpeq_epi8(energy, _mm256_setzero_si256()), inPopulation);
+
+    actor_updateStats_block<rules>(pPopulation->pStats, offset, self, alive);
+  }
+}
+
+template <typename rules>
+void actor_updateStats(actor_population *pPopulation, const viewCone *pCones)
+{
+  actor_updateStats_range<rules>(pPopulation, pCones, 0, pPopulation->count);
+}
+
+// The movement rules, shared by all level representations. `isBlocked(x, y)` returns true if the tile can't be entered.
+template <typename rules, typename blocked_func>
+static void actor_move_internal(actor_state *pActor, const blocked_func &isBlocked)
+{
+  constexpr int64_t LutX[_lookDirection_Count] = { -1, 0, 1, 0 };
+  constexpr int64_t LutY[_lookDirection_Count] = { 0, -1, 0, 1 };
+
+  const size_t oldEnergy = pActor->stats[as_Energy];
+  modify_with_clamp(pActor->stats[as_Energy], -rules::MovementEnergyCost);
+
+  if (oldEnergy < rules::MovementEnergyCost)
+    return;
+
+  const int64_t x = (int64_t)pActor->pos.x + LutX[pActor->look_at_dir];
+  const int64_t y = (int64_t)pActor->pos.y + LutY[pActor->look_at_dir];
+
+  if (isBlocked(x, y))
+  {
+    modify_with_clamp(pActor->stats[as_Energy], -rules::CollideEnergyCost);
+    return;
+  }
+
+  pActor->pos = vec2u16((uint16_t)x, (uint16_t)y);
+}
+
+template <typename rules, typename blocked_func>
+static void actor_moveTwo_internal(actor_state *pActor, const blocked_func &isBlocked)
+{
+  constexpr int64_t LutX[_lookDirection_Count] = { -1, 0, 1, 0 };
+  constexpr int64_t LutY[_lookDirection_Count] = { 0, -1, 0, 1 };
+
+  const size_t oldEnergy = pActor->stats[as_Energy];
+  modify_with_clamp(pActor->stats[as_Energy], rules::DoubleMovementEnergyCost);
+
+  if (oldEnergy < rules::DoubleMovementEnergyCost)
+    return;
+
+  const int64_t nearX = (int64_t)pActor->pos.x + LutX[pActor->look_at_dir];
+  const int64_t nearY = (int64_t)pActor->pos.y + LutY[pActor->look_at_dir];
+  const int64_t x = nearX + LutX[pActor->look_at_dir];
+  const int64_t y = nearY + LutY[pActor->look_at_dir];
+
+  if (isBlocked(x, y) || isBlocked(nearX, nearY))
+  {
+    modify_with_clamp(pActor->stats[as_Energy], -rules::CollideEnergyCost);
+    return;
+  }
+
+  pActor->pos = vec2u16((uint16_t)x, (uint16_t)y);
+}
+
+template <typename rules, typename level_type>
+void actor_move(actor_state *pActor, const level_type &lvl, const std::type_identity_t<level_occupancy_t<level_type>> *pOccupancy)
+{
+  lsAssert(pActor->pos.x < level_type::width && pActor->pos.y < level_type::height);
+  lsAssert(!(lvl.grid[pActor->pos.y * level_type::width + pActor->pos.x] & tf_Collidable));
+
+  // The walls keep the actor inside of the level.
+  actor_move_internal<rules>(pActor, [&](const int64_t x, const int64_t y)
+    {
+      const size_t idx = (size_t)(y * (int64_t)level_type::width + x);
+      return (lvl.grid[idx] & tf_Collidable) || (pOccupancy != nullptr && pOccupancy->count[idx]);
+    });
+}
+
+template <typename rules, typename level_type>
+void actor_moveTwo(actor_state *pActor, const level_type &lvl, const std::type_identity_t<level_occupancy_t<level_type>> *pOccupancy)
+{
+  lsAssert(pActor->pos.x < level_type::width && pActor->pos.y < level_type::height);
+  lsAssert(!(lvl.grid[pActor->pos.y * level_type::width + pActor->pos.x] & tf_Collidable));
+
+  actor_moveTwo_internal<rules>(pActor, [&](const int64_t x, const int64_t y)
+    {
+      const size_t idx = (size_t)(y * (int64_t)level_type::width + x);
+      return (lvl.grid[idx] & tf_Collidable) || (pOccupancy != nullptr && pOccupancy->count[idx]);
+    });
+}
+
+template <typename rules>
+void actor_move(actor_state *pActor, const chunked_level &lvl, chunked_level_cursor *pCursor)
+{
+  lsAssert(!(chunked_level_get(lvl, pActor->pos) & tf_Collidable));
+
+  const vec2u16 actorPos = pActor->pos;
+
+  actor_move_internal<rules>(pActor, [&](const int64_t x, const int64_t y)
+    {
+      return !chunked_level_contains(lvl, x, y) || (chunked_level_getNear(lvl, pCursor, actorPos, vec2u16((uint16_t)x, (uint16_t)y)) & tf_Collidable);
+    });
+}
+
+template <typename rules>
+void actor_moveTwo(actor_state *pActor, const chunked_level &lvl, chunked_level_cursor *pCursor)
+{
+  lsAssert(!(chunked_level_get(lvl, pActor->pos) & tf_Collidable));
+
+  const vec2u16 actorPos = pActor->pos;
+
+  actor_moveTwo_internal<rules>(pActor, [&](const int64_t x, const int64_t y)
+    {
+      return !chunked_level_contains(lvl, x, y) || (chunked_level_getNear(lvl, pCursor, actorPos, vec2u16((uint16_t)x, (uint16_t)y)) & tf_Collidable);
+    });
+}
+
+#define ACTOR_MOVE_INSTANTIATE(level_type, rules) \
+  template void actor_move<rules, level_type>(actor_state *, const level_type &, const level_occupancy_t<level_type> *); \
+  template void actor_moveTwo<rules, level_type>(actor_state *, const level_type &, const level_occupancy_t<level_type> *);
+
+#define ACTOR_MOVE_INSTANTIATE_FOR_RULES(rules) \
+  LEVEL_FOR_EACH_SIZE_WITH(ACTOR_MOVE_INSTANTIATE, rules) \
+  template void actor_move<rules>(actor_state *, const chunked_level &, chunked_level_cursor *); \
+  template void actor_moveTwo<rules>(actor_state *, const chunked_level &, chunked_level_cursor *);
+
+ACTOR_RULES_FOR_EACH(ACTOR_MOVE_INSTANTIATE_FOR_RULES)
+
+#undef ACTOR_MOVE_INSTANTIATE_FOR_RULES
+#undef ACTOR_MOVE_INSTANTIATE
+
+template <typename rules>
+void actor_turnLeft(actor_state *pActor)
+{
+  const size_t oldEnergy = pActor->stats[as_Energy];
+  modify_with_clamp(pActor->stats[as_Energy], rules::TurnEnergy);
+
+  if (oldEnergy < rules::TurnEnergy)
+    return;
+
+  pActor->look_at_dir = pActor->look_at_dir == ld_left ? ld_down : (lookDirection)(pActor->look_at_dir - 1);
+  lsAssert(pActor->look_at_dir < _lookDirection_Count);
+}
+
+template <typename rules>
+void actor_turnRight(actor_state *pActor)
+{
+  const size_t oldEnergy = pActor->stats[as_Energy];
+  modify_with_clamp(pActor->stats[as_Energy], rules::TurnEnergy);
+
+  if (oldEnergy < rules::TurnEnergy)
+    return;
+
+  pActor->look_at_dir = pActor->look_at_dir == ld_down ? ld_left : (lookDirection)(pActor->look_at_dir + 1);
+  lsAssert(pActor->look_at_dir < _lookDirection_Count);
+}
+
+template <typename rules, typename level_type>
+void actor_eat(actor_state *pActor, level_type *pLvl, const viewCone &cone, const std::type_identity_t<level_step_options_t<level_type>> *pOptions)
+{
+  lsAssert(pActor->pos.x < level_type::width && pActor->pos.y < level_type::height);
+
+  const size_t oldEnergy = pActor->stats[as_Energy];
+  modify_with_clamp(pActor->stats[as_Energy], rules::EatEnergyCost);
+
+  if (oldEnergy < rules::TurnEnergy)
+    return;
+
+  size_t stomachFoodCount = 0;
+
+  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
+    stomachFoodCount += pActor->stats[i];
+
+  lsAssert(stomachFoodCount <= rules::StomachCapacity);
+
+  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
+  {
+    if (cone[vcp_self] & (1ULL << i))
+    {
+      stomachFoodCount += modify_with_clamp(pActor->stats[i], rules::FoodAmount, lsMinValue<uint8_t>(), (uint8_t)((rules::StomachCapacity - stomachFoodCount) + pActor->stats[i]));
+      const size_t tileIndex = pActor->pos.y * level_type::width + pActor->pos.x;
+
+      if constexpr (std::is_same_v<level_type, level>)
+        if (pOptions != nullptr && pOptions->pUndoLog != nullptr)
+          level_undo_log_record(pOptions->pUndoLog, *pLvl, tileIndex);
+
+      pLvl->grid[tileIndex] &= ~(1ULL << i);
+
+      if constexpr (std::is_same_v<level_type, level>)
+      {
+        if (pOptions != nullptr && pOptions->pRegrowth != nullptr)
+          level_regrowth_schedule(pOptions->pRegrowth, tileIndex, (tileFlag)(1ULL << i));
+
+        if (pOptions != nullptr && pOptions->pGrowth != nullptr)
+          level_plant_growth_markTile(pOptions->pGrowth, tileIndex);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+actor_population::~actor_population()
+{
+  actor_population_destroy(this);
+}
+
+lsResult actor_population_reserve(actor_population *pPopulation, const size_t capacity)
+{
+  lsResult result = lsR_Success;
+
+  vec2u16 *pPos = nullptr;
+  uint8_t *pLookDir = nullptr;
+  uint8_t *pStats = nullptr;
+  uint8_t *pStomachRemainingCapacity = nullptr;
+  decltype(actor::brain) *pBrains = nullptr;
+  viewCone *pCones = nullptr;
+  uint8_t *pActions = nullptr;
+  uint32_t *pAliveBits = nullptr;
+
+  LS_ERROR_IF(pPopulation == nullptr, lsR_ArgumentNull);
+
+  if (pPopulation->pOccupancy == nullptr)
+  {
+    LS_ERROR_CHECK(lsAllocAligned(&pPopulation->pOccupancy));
+    level_occupancy_clear(pPopulation->pOccupancy);
+  }
+
+  if (pPopulation->capacity < capacity)
+  {
+    const size_t newCapacity = ((capacity + actor_population::capacity_granularity - 1) / actor_population::capacity_granularity) * actor_population::capacity_granularity;
+
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pPos, newCapacity));
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pLookDir, newCapacity));
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pStats, newCapacity * _actorStats_Count)); // all stats share one allocation.
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pStomachRemainingCapacity, newCapacity));
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pBrains, newCapacity, alignof(decltype(actor::brain))));
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pCones, newCapacity));
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pActions, newCapacity));
+    LS_ERROR_CHECK(lsAllocAlignedZero(&pAliveBits, newCapacity / actor_population::capacity_granularity));
+
+    if (pPopulation->count > 0)
+    {
+      lsMemcpy(pPos, pPopulation->pPos, pPopulation->count);
+      lsMemcpy(pLookDir, pPopulation->pLookDir, pPopulation->count);
+      lsMemcpy(pStomachRemainingCapacity, pPopulation->pStomachRemainingCapacity, pPopulation->count);
+      lsMemcpy(pBrains, pPopulation->pBrains, pPopulation->count);
+      lsMemcpy(pAliveBits, pPopulation->pAliveBits, pPopulation->capacity / actor_population::capacity_granularity);
+
+      for (size_t i = 0; i < _actorStats_Count; i++)
+        lsMemcpy(pStats + i * newCapacity, pPopulation->pStats[i], pPopulation->count);
+    }
+
+    const size_t count = pPopulation->count;
+    const size_t aliveCount = pPopulation->aliveCount;
+    level_occupancy *pOccupancy = pPopulation->pOccupancy;
+    pPopulation->pOccupancy = nullptr;
+
+    actor_population_destroy(pPopulation);
+
+    pPopulation->count = count;
+    pPopulation->aliveCount = aliveCount;
+    pPopulation->pOccupancy = pOccupancy;
+    pPopulation->capacity = newCapacity;
+    pPopulation->pPos = pPos;
+    pPopulation->pLookDir = pLookDir;
+    pPopulation->pStomachRemainingCapacity = pStomachRemainingCapacity;
+    pPopulation->pBrains = pBrains;
+    pPopulation->pCones = pCones;
+    pPopulation->pActions = pActions;
+    pPopulation->pAliveBits = pAliveBits;
+
+    for (size_t i = 0; i < _actorStats_Count; i++)
+      pPopulation->pStats[i] = pStats + i * newCapacity;
+  }
+
+epilogue:
+  if (LS_FAILED(result))
+  {
+    lsFreeAlignedPtr(&pPos);
+    lsFreeAlignedPtr(&pLookDir);
+    lsFreeAlignedPtr(&pStats);
+    lsFreeAlignedPtr(&pStomachRemainingCapacity);
+    lsFreeAlignedPtr(&pBrains);
+    lsFreeAlignedPtr(&pCones);
+    lsFreeAlignedPtr(&pActions);
+    lsFreeAlignedPtr(&pAliveBits);
+  }
+
+  return result;
+}
+
+lsResult actor_population_add(actor_population *pPopulation, const actor &a, _Out_opt_ size_t *pIndex)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPopulation == nullptr, lsR_ArgumentNull);
+
+  if (pPopulation->count == pPopulation->capacity)
+    LS_ERROR_CHECK(actor_population_reserve(pPopulation, lsMax(pPopulation->capacity * 2, actor_population::capacity_granularity)));
+
+  {
+    const size_t index = pPopulation->count;
+    pPopulation->count++;
+
+    actor_population_setState(pPopulation, index, a);
+    pPopulation->pBrains[index] = a.brain;
+
+    if (a.stats[as_Energy])
+    {
+      level_occupancy_add(pPopulation->pOccupancy, a.pos);
+
+      pPopulation->pAliveBits[index / actor_population::capacity_granularity] |= 1U << (index % actor_population::capacity_granularity);
+      pPopulation->aliveCount++;
+    }
+
+    if (pIndex != nullptr)
+      *pIndex = index;
+  }
+
+epilogue:
+  return result;
+}
+
+void actor_population_clear(actor_population *pPopulation)
+{
+  if (pPopulation == nullptr)
+    return;
+
+  if (pPopulation->pAliveBits != nullptr)
+    lsZeroMemory(pPopulation->pAliveBits, pPopulation->capacity / actor_population::capacity_granularity);
+
+  pPopulation->count = 0;
+  pPopulation->aliveCount = 0;
+
+  if (pPopulation->pOccupancy != nullptr)
+    level_occupancy_clear(pPopulation->pOccupancy);
+}
+
+lsResult actor_population_restoreStates(actor_population *pPopulation, const actor_state *pStates, const size_t count)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pPopulation == nullptr || (pStates == nullptr && count > 0), lsR_ArgumentNull);
+  LS_ERROR_CHECK(actor_population_reserve(pPopulation, count));
+
+  if (count > pPopulation->count)
+    lsZeroMemory(pPopulation->pBrains + pPopulation->count, count - pPopulation->count);
+
+  actor_population_clear(pPopulation);
+  pPopulation->count = count;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    actor_population_setState(pPopulation, i, pStates[i]);
+
+    if (pStates[i].stats[as_Energy])
+    {
+      level_occupancy_add(pPopulation->pOccupancy, pStates[i].pos);
+
+      pPopulation->pAliveBits[i / actor_population::capacity_granularity] |= 1U << (i % actor_population::capacity_granularity);
+      pPopulation->aliveCount++;
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+void actor_population_destroy(actor_population *pPopulation)
+{
+  if (pPopulation == nullptr)
+    return;
+
+  lsFreeAlignedPtr(&pPopulation->pPos);
+  lsFreeAlignedPtr(&pPopulation->pLookDir);
+  lsFreeAlignedPtr(&pPopulation->pStats[0]);
+  lsFreeAlignedPtr(&pPopulation->pStomachRemainingCapacity);
+  lsFreeAlignedPtr(&pPopulation->pBrains);
+  lsFreeAlignedPtr(&pPopulation->pCones);
+  lsFreeAlignedPtr(&pPopulation->pActions);
+  lsFreeAlignedPtr(&pPopulation->pAliveBits);
+  lsFreeAlignedPtr(&pPopulation->pOccupancy);
+
+  for (size_t i = 0; i < _actorStats_Count; i++)
+    pPopulation->pStats[i] = nullptr;
+
+  pPopulation->count = 0;
+  pPopulation->aliveCount = 0;
+  pPopulation->capacity = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lockstep_batch::~lockstep_batch()
+{
+  lockstep_batch_destroy(this);
+}
+
+lsResult lockstep_batch_init(lockstep_batch *pBatch)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pBatch == nullptr, lsR_ArgumentNull);
+
+  lockstep_batch_destroy(pBatch);
+
+  LS_ERROR_CHECK(lsAllocAlignedZero(&pBatch->pLevels, lockstep_batch::max_lanes));
+  LS_ERROR_CHECK(actor_population_reserve(&pBatch->actors, lockstep_batch::max_lanes));
+
+epilogue:
+  return result;
+}
+
+lsResult lockstep_batch_add(lockstep_batch *pBatch, const level &lvl, const actor &a, _Out_opt_ size_t *pLane)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pBatch == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pBatch->pLevels == nullptr, lsR_ResourceStateInvalid);
+  LS_ERROR_IF(pBatch->actors.count >= lockstep_batch::max_lanes, lsR_ResourceFull);
+
+  {
+    size_t lane;
+    LS_ERROR_CHECK(actor_population_add(&pBatch->actors, a, &lane));
+    pBatch->pLevels[lane] = lvl;
+
+    if (pLane != nullptr)
+      *pLane = lane;
+  }
+
+epilogue:
+  return result;
+}
+
+void lockstep_batch_clear(lockstep_batch *pBatch)
+{
+  if (pBatch == nullptr)
+    return;
+
+  // Lanes past `count` must not pass for alive ones.
+  lsZeroMemory(pBatch->actors.pStats[as_Energy], pBatch->actors.capacity);
+  actor_population_clear(&pBatch->actors);
+}
+
+void lockstep_batch_destroy(lockstep_batch *pBatch)
+{
+  if (pBatch == nullptr)
+    return;
+
+  lsFreeAlignedPtr(&pBatch->pLevels);
+  actor_population_destroy(&pBatch->actors);
+}
+
+// Packs the low byte of every 32 bit lane into the low 8 bytes.
+inline static uint64_t lockstep_packLowBytes(const __m256i v)
+{
+  const __m256i bytes = _mm256_shuffle_epi8(v, _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+  const __m256i packed = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+
+  return (uint64_t)_mm_cvtsi128_si64(_mm256_castsi256_si128(packed));
+}
+
+inline static __m256i lockstep_loadBytes(const uint8_t *pBytes)
+{
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pBytes)));
+}
+
+inline static __m256i lockstep_laneMask(const uint32_t laneBits)
+{
+  const __m256i bits = _mm256_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6, 1 << 7);
+  return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int32_t)laneBits), bits), bits);
+}
+
+inline static __m256i lockstep_isCollidable(const __m256i tiles)
+{
+  const __m256i collidable = _mm256_set1_epi32(tf_Collidable);
+  return _mm256_cmpeq_epi32(_mm256_and_si256(tiles, collidable), collidable);
+}
+
+template <typename rules>
+size_t lockstep_batch_step(lockstep_batch *pBatch)
+{
+  constexpr size_t groupLanes = sizeof(__m256i) / sizeof(int32_t);
+  constexpr size_t groupCount = lockstep_batch::max_lanes / groupLanes;
+
+  static_assert(lockstep_batch::max_lanes == sizeof(__m256i));
+  static_assert(sizeof(vec2u16) == sizeof(int32_t));
+  static_assert(sizeof(level) * lockstep_batch::max_lanes <= (size_t)lsMaxValue<int32_t>());
+
+  // Gathers load 4 bytes per tile. The view cone never reaches past the last row of the level, so the 3 trailing bytes stay inside of it, even for the last lane.
+  static_assert(level::wallThickness >= 3);
+
+  lsAssert(pBatch != nullptr && pBatch->pLevels != nullptr);
+
+  actor_population &actors = pBatch->actors;
+  const int32_t *pGridBase = reinterpret_cast<const int32_t *>(pBatch->pLevels[0].grid);
+
+  // Dead lanes and lanes past `count` have zero energy.
+  const __m256i energyAtStart = _mm256_load_si256(reinterpret_cast<const __m256i *>(actors.pStats[as_Energy]));
+  const uint32_t aliveBits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(energyAtStart, _mm256_setzero_si256()));
+
+  if (aliveBits == 0)
+    return 0;
+
+  viewCone cones[lockstep_batch::max_lanes];
+  LS_ALIGN(32) uint8_t actions[lockstep_batch::max_lanes];
+
+  // Gather the view cones.
+  for (size_t group = 0; group < groupCount; group++)
+  {
+    const size_t firstLane = group * groupLanes;
+    const __m256i alive = lockstep_laneMask(aliveBits >> firstLane);
+
+    const __m256i pos = _mm256_load_si256(reinterpret_cast<const __m256i *>(actors.pPos + firstLane));
+    const __m256i dir = lockstep_loadBytes(actors.pLookDir + firstLane);
+    const __m256i laneBase = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_set1_epi32((int32_t)firstLane), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)), _mm256_set1_epi32((int32_t)sizeof(level)));
+    const __m256i tileIndex = _mm256_add_epi32(laneBase, _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(pos, 16), _mm256_set1_epi32(viewCone_width)), _mm256_and_si256(pos, _mm256_set1_epi32(0xFFFF))));
+
+    viewCone_gather8(pGridBase, nullptr, tileIndex, dir, alive, cones + firstLane); // one actor per level, there is nobody else to see.
+  }
+
+  // Update the stats.
+  {
+    const __m256i alive = _mm256_xor_si256(_mm256_cmpeq_epi8(energyAtStart, _mm256_setzero_si256()), _mm256_set1_epi8(-1));
+    actor_updateStats_block<rules>(actors.pStats, 0, viewCone_gatherSelf32(cones), alive);
+  }
+
+  // Evaluate the brains.
+  for (uint32_t remaining = aliveBits; remaining != 0; remaining &= remaining - 1)
+  {
+    const size_t lane = (size_t)lsLowestBit(remaining);
+
+    const viewCone &cone = cones[lane];
+
+    uint8_t stats[_actorStats_Count];
+
+    for (size_t i = 0; i < _actorStats_Count; i++)
+      stats[i] = actors.pStats[i][lane];
+
+    actions[lane] = (uint8_t)actor_chooseAction(actors.pBrains[lane], cone, stats);
+  }
+
+  // Apply move & turn actions, the same way `actor_move`, `actor_moveTwo`, `actor_turnLeft` and `actor_turnRight` would.
+  uint32_t eatBits = 0;
+
+  for (size_t group = 0; group < groupCount; group++)
+  {
+    const size_t firstLane = group * groupLanes;
+    const __m256i alive = lockstep_laneMask(aliveBits >> firstLane);
+
+    const __m256i action = lockstep_loadBytes(actions + firstLane);
+    const __m256i isMove = _mm256_and_si256(alive, _mm256_cmpeq_epi32(action, _mm256_set1_epi32(aa_Move)));
+    const __m256i isMove2 = _mm256_and_si256(alive, _mm256_cmpeq_epi32(action, _mm256_set1_epi32(aa_Move2)));
+    const __m256i isTurnLeft = _mm256_and_si256(alive, _mm256_cmpeq_epi32(action, _mm256_set1_epi32(aa_TurnLeft)));
+    const __m256i isTurnRight = _mm256_and_si256(alive, _mm256_cmpeq_epi32(action, _mm256_set1_epi32(aa_TurnRight)));
+    const __m256i isEat = _mm256_and_si256(alive, _mm256_cmpeq_epi32(action, _mm256_set1_epi32(aa_Eat)));
+
+    eatBits |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(isEat)) << firstLane;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i maxEnergy = _mm256_set1_epi32(lsMaxValue<uint8_t>());
+
+    const __m256i pos = _mm256_load_si256(reinterpret_cast<const __m256i *>(actors.pPos + firstLane));
+    const __m256i dir = lockstep_loadBytes(actors.pLookDir + firstLane);
+    const __m256i energy = lockstep_loadBytes(actors.pStats[as_Energy] + firstLane);
+
+    // `vec2u16` deltas, one packed 32 bit value per direction, so they can be applied with a single 16 bit add.
+    const __m256i step = _mm256_permutevar8x32_epi32(_mm256_setr_epi32(0x0000FFFF, (int32_t)0xFFFF0000, 0x00000001, 0x00010000, 0, 0, 0, 0), dir);
+    const __m256i tileStep = _mm256_permutevar8x32_epi32(_mm256_setr_epi32(-1, -viewCone_width, 1, viewCone_width, 0, 0, 0, 0), dir);
+
+    const __m256i laneBase = _mm256_mullo_epi32(_mm256_add_epi32(_mm256_set1_epi32((int32_t)firstLane), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)), _mm256_set1_epi32((int32_t)sizeof(level)));
+    const __m256i tileIndex = _mm256_add_epi32(laneBase, _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(pos, 16), _mm256_set1_epi32(viewCone_width)), _mm256_and_si256(pos, _mm256_set1_epi32(0xFFFF))));
+    const __m256i nearIndex = _mm256_add_epi32(tileIndex, tileStep);
+    const __m256i farIndex = _mm256_add_epi32(nearIndex, tileStep);
+
+    const __m256i movers = _mm256_or_si256(isMove, isMove2);
+    const __m256i nearBlocked = lockstep_isCollidable(_mm256_mask_i32gather_epi32(zero, pGridBase, nearIndex, movers, 1));
+    const __m256i farBlocked = _mm256_or_si256(nearBlocked, lockstep_isCollidable(_mm256_mask_i32gather_epi32(zero, pGridBase, farIndex, isMove2, 1)));
+
+    // Move
+    const __m256i canMove = _mm256_and_si256(isMove, _mm256_cmpgt_epi32(energy, _mm256_set1_epi32((int32_t)rules::MovementEnergyCost - 1)));
+    const __m256i moved = _mm256_andnot_si256(nearBlocked, canMove);
+    __m256i moveEnergy = _mm256_max_epi32(_mm256_sub_epi32(energy, _mm256_set1_epi32((int32_t)rules::MovementEnergyCost)), zero);
+    moveEnergy = _mm256_blendv_epi8(moveEnergy, _mm256_max_epi32(_mm256_sub_epi32(moveEnergy, _mm256_set1_epi32((int32_t)rules::CollideEnergyCost)), zero), _mm256_and_si256(canMove, nearBlocked));
+
+    // Move Two
+    const __m256i canMove2 = _mm256_and_si256(isMove2, _mm256_cmpgt_epi32(energy, _mm256_set1_epi32((int32_t)rules::DoubleMovementEnergyCost - 1)));
+    const __m256i moved2 = _mm256_andnot_si256(farBlocked, canMove2);
+    __m256i move2Energy = _mm256_min_epi32(_mm256_add_epi32(energy, _mm256_set1_epi32((int32_t)rules::DoubleMovementEnergyCost)), maxEnergy);
+    move2Energy = _mm256_blendv_epi8(move2Energy, _mm256_max_epi32(_mm256_sub_epi32(move2Energy, _mm256_set1_epi32((int32_t)rules::CollideEnergyCost)), zero), _mm256_and_si256(canMove2, farBlocked));
+
+    // Turn
+    const __m256i canTurn = _mm256_cmpgt_epi32(energy, _mm256_set1_epi32((int32_t)rules::TurnEnergy - 1));
+    const __m256i turnEnergy = _mm256_min_epi32(_mm256_add_epi32(energy, _mm256_set1_epi32((int32_t)rules::TurnEnergy)), maxEnergy);
+    const __m256i directionMask = _mm256_set1_epi32(_lookDirection_Count - 1);
+    const __m256i dirLeft = _mm256_and_si256(_mm256_add_epi32(dir, directionMask), directionMask);
+    const __m256i dirRight = _mm256_and_si256(_mm256_add_epi32(dir, _mm256_set1_epi32(1)), directionMask);
+
+    __m256i newEnergy = energy;
+    newEnergy = _mm256_blendv_epi8(newEnergy, moveEnergy, isMove);
+    newEnergy = _mm256_blendv_epi8(newEnergy, move2Energy, isMove2);
+    newEnergy = _mm256_blendv_epi8(newEnergy, turnEnergy, _mm256_or_si256(isTurnLeft, isTurnRight));
+
+    __m256i newPos = pos;
+    newPos = _mm256_blendv_epi8(newPos, _mm256_add_epi16(pos, step), moved);
+    newPos = _mm256_blendv_epi8(newPos, _mm256_add_epi16(pos, _mm256_add_epi16(step, step)), moved2);
+
+    __m256i newDir = dir;
+    newDir = _mm256_blendv_epi8(newDir, dirLeft, _mm256_and_si256(isTurnLeft, canTurn));
+    newDir = _mm256_blendv_epi8(newDir, dirRight, _mm256_and_si256(isTurnRight, canTurn));
+
+    _mm256_store_si256(reinterpret_cast<__m256i *>(actors.pPos + firstLane), newPos);
+
+    const uint64_t packedDir = lockstep_packLowBytes(newDir);
+    const uint64_t packedEnergy = lockstep_packLowBytes(newEnergy);
+    lsMemcpy(actors.pLookDir + firstLane, reinterpret_cast<const uint8_t *>(&packedDir), groupLanes);
+    lsMemcpy(actors.pStats[as_Energy] + firstLane, reinterpret_cast<const uint8_t *>(&packedEnergy), groupLanes);
+  }
+
+  // Eating writes to the level, which isn't worth vectorizing.
+  for (uint32_t remaining = eatBits; remaining != 0; remaining &= remaining - 1)
+  {
+    const size_t lane = (size_t)lsLowestBit(remaining);
+
+    const viewCone &cone = cones[lane];
+
+    actor_state state = actor_population_getState(actors, lane);
+    actor_eat<rules>(&state, &pBatch->pLevels[lane], cone, nullptr);
+    actor_population_setState(&actors, lane, state);
+  }
+
+  const __m256i energyAfter = _mm256_load_si256(reinterpret_cast<const __m256i *>(actors.pStats[as_Energy]));
+  const uint32_t aliveAfterBits = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(energyAfter, _mm256_setzero_si256()));
+
+  // Keep the population's view of which lanes are alive in sync.
+  actors.pAliveBits[0] = aliveAfterBits;
+  actors.aliveCount = (size_t)std::popcount(aliveAfterBits);
+
+  return actors.aliveCount;
+}
+
+#define ACTOR_STEP_INSTANTIATE(level_type, rules) \
+  template void actor_act<rules, level_type>(actor_state *, level_type *, const viewCone &, const actorAction, level_occupancy_t<level_type> *, const level_step_options_t<level_type> *); \
+  template size_t level_performStep<rules, level_type>(level_type &, actor *, const size_t, const level_step_options_t<level_type> &);
+
+#define ACTOR_RULES_INSTANTIATE(rules) \
+  LEVEL_FOR_EACH_SIZE_WITH(ACTOR_STEP_INSTANTIATE, rules) \
+  template void actor_updateStats<rules>(actor_state *, const viewCone &); \
+  template void actor_updateStats<rules>(actor_population *, const viewCone *); \
+  template size_t level_performStep<rules>(level &, actor_population *, thread_pool *, const level_step_options &); \
+  template size_t lockstep_batch_step<rules>(lockstep_batch *);
+
+ACTOR_RULES_FOR_EACH(ACTOR_RULES_INSTANTIATE)
+
+#undef ACTOR_RULES_INSTANTIATE
+#undef ACTOR_STEP_INSTANTIATE
+
+//////////////////////////////////////////////////////////////////////////
+
+struct proto_chance_config
+{
+  static constexpr uint64_t chanceOf1024 = 12;
+};
+
+struct proto_config // TODO!
+{
+  using mutator = mutator_chance<proto_chance_config>; // ?
+  using crossbreeder = crossbreeder_naive;
+
+  static constexpr size_t survivingGenes = 4;
+  static constexpr size_t newGenesPerGeneration = 4;
+};
+
+template <typename crossbreeder>
+void crossbreed(actor &val, const actor &parentA, const actor &parentB, const crossbreeder &c)
+{
+  crossbreeder_eval(c, val.brain.values, LS_ARRAYSIZE(val.brain.values), parentA.brain.values, parentB.brain.values);
+}
+
+template <typename mutator>
+void mutate(actor &target, const mutator &m)
+{
+  mutator_eval(m, target.brain.values, LS_ARRAYSIZE(target.brain.values), (int16_t)lsMinValue<int8_t>(), (int16_t)lsMaxValue<int8_t>()); // the values are stored as `int8_t`.
+}
+
+void actor_initRandom(actor *pActor)
+{
+  pActor->stats[as_Air] = (uint8_t)lsGetRand();
+  pActor->stats[as_Energy] = 255;
+
+  for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
+    pActor->stats[i] = (uint8_t)(lsGetRand() % 64); // stay within the stomach capacity.
+
+  pActor->stomach_remaining_capacity = 0;
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(pActor->brain.values); i++)
+    pActor->brain.values[i] = (int8_t)lsGetRand();
+}
+
+// TODO: Eval Funcs... -> Give scores
+
+//////////////////////////////////////////////////////////////////////////
+
+#include <time.h>
+
+lsResult save_brain(const char *dir, const actor &actr)
+{
+  lsResult result = lsR_Success;
+
+  const uint64_t now = (uint64_t)time(nullptr);
+  char filename[256];
+  sformat_to(filename, LS_ARRAYSIZE(filename), dir, "/", now, ".brain");
+
+  print("Saving brain to file: '", filename, '\n');
+
+  {
+    cached_file_byte_stream_writer<> write_stream;
+    LS_ERROR_CHECK(write_byte_stream_init(write_stream, filename));
+    value_writer<decltype(write_stream)> writer;
+    LS_ERROR_CHECK(value_writer_init(writer, &write_stream));
+
+    LS_ERROR_CHECK(neural_net_write(actr.brain, writer));
+    LS_ERROR_CHECK(write_byte_stream_flush(write_stream));
+  }
+
+epilogue:
+  return result;
+}
+
+lsResult load_brain_from_file(const char *filename, actor &actr)
+{
+  lsResult result = lsR_Success;
+
+  print("Loading brain from file: ", filename, '\n');
+
+  cached_file_byte_stream_reader<> read_stream;
+  value_reader<cached_file_byte_stream_reader<>> reader;
+  LS_ERROR_CHECK(read_byte_stream_init(read_stream, filename));
+  LS_ERROR_CHECK(value_reader_init(reader, &read_stream));
+
+  LS_ERROR_CHECK(neural_net_read(actr.brain, reader));
+  read_byte_stream_destroy(read_stream);
+
+epilogue:
+  return result;
+}
+
+lsResult load_newest_brain(const char *dir, actor &actr)
+{
+  lsResult result = lsR_Success;
+
+  const std::filesystem::path path(dir);
+
+  int64_t bestTime = -1;
+  std::string best;
+
+  for (const std::filesystem::directory_entry &dir_entry : std::filesystem::directory_iterator(dir))
+  {
+    if (dir_entry.is_regular_file())
+    {
+      const std::filesystem::file_time_type &timestamp = dir_entry.last_write_time();
+      const int64_t timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+
+      if (bestTime < timeMs)
+      {
+        bestTime = timeMs;
+        best = dir_entry.path().filename().string();
+      }
+    }
+  }
+
+  lsAssert(bestTime >= 0);
+  LS_ERROR_CHECK(load_brain_from_file(best.c_str(), actr));
+
+epilogue:
+  return result;
+}
+
+// load specific brain: list and then select in console
+
+// train: load actor, start training, save actor whilst training, reevaluate scores... save
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "level_generator.h"
+
+DEFINE_TESTABLE(actor_population_step_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevelA = nullptr;
+  level *pLevelB = nullptr;
+  actor *pActor = nullptr;
+  level_regrowth *pRegrowthA = nullptr;
+  level_regrowth *pRegrowthB = nullptr;
+  actor_population population;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelA));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelB));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActor));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRegrowthA));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRegrowthB));
+
+  for (size_t run = 0; run < 16; run++)
+  {
+    level_gen_water_food_level(pLevelA);
+    *pLevelB = *pLevelA;
+
+    // Every other run with growing plants and regrowing food.
+    level_plant_growth growthA, growthB;
+    level_plant_growth_init(&growthA);
+    level_plant_growth_init(&growthB);
+
+    level_regrowth_init(pRegrowthA, 5);
+    level_regrowth_init(pRegrowthB, 5);
+
+    new (pActor) actor(vec2u8(level::width / 2, level::height / 2), (lookDirection)(run % _lookDirection_Count));
+    actor_initRandom(pActor);
+
+    actor_population_clear(&population);
+    TESTABLE_ASSERT_SUCCESS(actor_population_add(&population, *pActor));
+
+    for (size_t step = 0; step < 64 && pActor->stats[as_Energy]; step++)
+    {
+      level_step_options optionsA, optionsB;
+
+      if (run & 1)
+      {
+        optionsA.pGrowth = &growthA;
+        optionsA.pRegrowth = pRegrowthA;
+        optionsB.pGrowth = &growthB;
+        optionsB.pRegrowth = pRegrowthB;
+      }
+
+      level_performStep(*pLevelA, pActor, 1, optionsA);
+      level_performStep(*pLevelB, &population, nullptr, optionsB);
+
+      const actor_state state = actor_population_getState(population, 0);
+
+      TESTABLE_ASSERT_EQUAL(state.pos, pActor->pos);
+      TESTABLE_ASSERT_EQUAL(state.look_at_dir, pActor->look_at_dir);
+
+      for (size_t i = 0; i < _actorStats_Count; i++)
+        TESTABLE_ASSERT_EQUAL(state.stats[i], pActor->stats[i]);
+
+      TESTABLE_ASSERT_EQUAL(memcmp(pLevelA->grid, pLevelB->grid, sizeof(pLevelA->grid)), 0);
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevelA);
+  lsFreePtr(&pLevelB);
+  lsFreeAlignedPtr(&pActor);
+  lsFreePtr(&pRegrowthA);
+  lsFreePtr(&pRegrowthB);
+  return result;
+}
+
+DEFINE_TESTABLE(lockstep_batch_step_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevels = nullptr;
+  actor *pActors = nullptr;
+  lockstep_batch batch;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevels, lockstep_batch::max_lanes));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActors, lockstep_batch::max_lanes));
+  TESTABLE_ASSERT_SUCCESS(lockstep_batch_init(&batch));
+
+  for (const size_t laneCount : { lockstep_batch::max_lanes, (size_t)13, (size_t)1 })
+  {
+    lockstep_batch_clear(&batch);
+
+    for (size_t lane = 0; lane < laneCount; lane++)
+    {
+      level_gen_water_food_level(&pLevels[lane]);
+
+      new (&pActors[lane]) actor(vec2u8(level::width / 2, level::height / 2), (lookDirection)(lane % _lookDirection_Count));
+      actor_initRandom(&pActors[lane]);
+
+      TESTABLE_ASSERT_SUCCESS(lockstep_batch_add(&batch, pLevels[lane], pActors[lane]));
+    }
+
+    for (size_t step = 0; step < 128; step++)
+    {
+      size_t expectedAliveCount = 0;
+
+      for (size_t lane = 0; lane < laneCount; lane++)
+      {
+        if (pActors[lane].stats[as_Energy])
+          level_performStep(pLevels[lane], &pActors[lane], 1);
+
+        expectedAliveCount += !!pActors[lane].stats[as_Energy];
+      }
+
+      TESTABLE_ASSERT_EQUAL(lockstep_batch_step(&batch), expectedAliveCount);
+
+      for (size_t lane = 0; lane < laneCount; lane++)
+      {
+        const actor_state state = actor_population_getState(batch.actors, lane);
+
+        TESTABLE_ASSERT_EQUAL(state.pos, pActors[lane].pos);
+        TESTABLE_ASSERT_EQUAL(state.look_at_dir, pActors[lane].look_at_dir);
+
+        for (size_t i = 0; i < _actorStats_Count; i++)
+          TESTABLE_ASSERT_EQUAL(state.stats[i], pActors[lane].stats[i]);
+
+        TESTABLE_ASSERT_EQUAL(memcmp(pLevels[lane].grid, batch.pLevels[lane].grid, sizeof(pLevels[lane].grid)), 0);
+      }
+
+      if (expectedAliveCount == 0)
+        break;
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevels);
+  lsFreeAlignedPtr(&pActors);
+  return result;
+}
+
+DEFINE_TESTABLE(actor_updateStats_population_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t actorCount = 77; // not a multiple of the block size.
+  constexpr uint8_t edgeValues[] = { 0, 1, 2, 3, 4, 5, 8, 9, 250, 252, 253, 254, 255 };
+
+  actor_population population;
+  actor_state *pStates = nullptr;
+  viewCone *pCones = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(actor_population_reserve(&population, actorCount));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pStates, actorCount));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pCones, actorCount));
+
+  population.count = actorCount;
+
+  for (size_t round = 0; round < 256; round++)
+  {
+    for (size_t i = 0; i < actorCount; i++)
+    {
+      lsZeroMemory(&pStates[i]);
+
+      for (size_t j = 0; j < _actorStats_Count; j++)
+        pStates[i].stats[j] = (lsGetRand() & 1) ? edgeValues[lsGetRand() % LS_ARRAYSIZE(edgeValues)] : (uint8_t)lsGetRand();
+
+      for (size_t j = 0; j < _viewConePosition_Count; j++)
+        pCones[i].values[j] = (uint8_t)lsGetRand();
+
+      population.pCones[i] = pCones[i];
+      actor_population_setState(&population, i, pStates[i]);
+
+      if (pStates[i].stats[as_Energy])
+        actor_updateStats(&pStates[i], pCones[i]);
+    }
+
+    actor_updateStats(&population, population.pCones);
+
+    for (size_t i = 0; i < actorCount; i++)
+      for (size_t j = 0; j < _actorStats_Count; j++)
+        TESTABLE_ASSERT_EQUAL(population.pStats[j][i], pStates[i].stats[j]);
+  }
+
+epilogue:
+  lsFreePtr(&pStates);
+  lsFreePtr(&pCones);
+  return result;
+}
+
+// Any rule set can be used within this file, others have to be added to `ACTOR_RULES_FOR_EACH`.
+struct actor_rules_harsh_internal : actor_rules_default
+{
+  static constexpr int64_t IdleEnergyCost = 7;
+  static constexpr int64_t UnderwaterAirCost = 11;
+  static constexpr int64_t MovementEnergyCost = 40;
+  static constexpr int64_t CollideEnergyCost = 20;
+  static constexpr int64_t FoodAmount = 9;
+};
+
+DEFINE_TESTABLE(actor_rules_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevelA = nullptr;
+  level *pLevelB = nullptr;
+  actor *pActorA = nullptr;
+  actor *pActorB = nullptr;
+  actor_population population;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelA));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelB));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActorA));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActorB));
+
+  // The scalar and the population step have to agree on a custom rule set as well.
+  for (size_t run = 0; run < 8; run++)
+  {
+    level_gen_water_food_level(pLevelA);
+    *pLevelB = *pLevelA;
+
+    new (pActorA) actor(vec2u8(level::width / 2, level::height / 2), (lookDirection)(run % _lookDirection_Count));
+    actor_initRandom(pActorA);
+
+    actor_population_clear(&population);
+    TESTABLE_ASSERT_SUCCESS(actor_population_add(&population, *pActorA));
+
+    for (size_t step = 0; step < 64 && pActorA->stats[as_Energy]; step++)
+    {
+      level_performStep<actor_rules_harsh_internal>(*pLevelA, pActorA, 1, {});
+      level_performStep<actor_rules_harsh_internal>(*pLevelB, &population, nullptr, {});
+
+      const actor_state state = actor_population_getState(population, 0);
+
+      TESTABLE_ASSERT_EQUAL(state.pos, pActorA->pos);
+      TESTABLE_ASSERT_EQUAL(state.look_at_dir, pActorA->look_at_dir);
+
+      for (size_t i = 0; i < _actorStats_Count; i++)
+        TESTABLE_ASSERT_EQUAL(state.stats[i], pActorA->stats[i]);
+
+      TESTABLE_ASSERT_EQUAL(memcmp(pLevelA->grid, pLevelB->grid, sizeof(pLevelA->grid)), 0);
+    }
+  }
+
+  // The rules are actually applied.
+  {
+    viewCone cone;
+    lsZeroMemory(&cone);
+
+    new (pActorA) actor(vec2u8(level::width / 2, level::height / 2), ld_up);
+    actor_initRandom(pActorA);
+    pActorA->stats[as_Energy] = 128; // far enough from both bounds for the food energy and the idle cost.
+    *pActorB = *pActorA;
+
+    actor_updateStats(pActorA, cone);
+    actor_updateStats<actor_rules_harsh_internal>(pActorB, cone);
+
+    TESTABLE_ASSERT_EQUAL((int64_t)pActorA->stats[as_Energy] - pActorB->stats[as_Energy], actor_rules_harsh_internal::IdleEnergyCost - actor_rules_default::IdleEnergyCost);
+  }
+
+epilogue:
+  lsFreePtr(&pLevelA);
+  lsFreePtr(&pLevelB);
+  lsFreeAlignedPtr(&pActorA);
+  lsFreeAlignedPtr(&pActorB);
+  return result;
+}
+
+DEFINE_TESTABLE(actor_encodeInputs_test)
+{
+  lsResult result = lsR_Success;
+
+  for (size_t round = 0; round < 1024; round++)
+  {
+    viewCone cone;
+    uint8_t stats[_actorStats_Count];
+
+    for (size_t i = 0; i < LS_ARRAYSIZE(cone.values); i++)
+      cone.values[i] = (uint8_t)lsGetRand();
+
+    for (size_t i = 0; i < LS_ARRAYSIZE(stats); i++)
+      stats[i] = (uint8_t)lsGetRand();
+
+    // Reference: one bit at a time.
+    decltype(actor::brain)::io_buffer_t expected;
+
+    for (size_t j = 0; j < LS_ARRAYSIZE(cone.values); j++)
+      for (size_t k = 0, bit = 1; k < 8; k++, bit <<= 1)
+        expected[j * 8 + k] = (int8_t)(cone[(viewConePosition)j] & bit);
+
+    neural_net_buffer_prepare(expected, (LS_ARRAYSIZE(cone.values) * 8) / expected.block_size);
+
+    for (size_t j = 0; j < _actorStats_Count; j++)
+      expected[LS_ARRAYSIZE(cone.values) * 8 + j] = (int8_t)((int64_t)stats[j] - 128);
+
+    decltype(actor::brain)::io_buffer_t actual;
+    actor_encodeInputs(actual, cone, stats);
+
+    for (size_t i = 0; i < LS_ARRAYSIZE(cone.values) * 8 + _actorStats_Count; i++)
+      TESTABLE_ASSERT_EQUAL(actual[i], expected[i]);
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(viewCone_get_many_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t maxCount = 37;
+
+  level *pLevel = nullptr;
+  vec2u16 pos[maxCount];
+  uint8_t dir[maxCount];
+  viewCone cones[maxCount + 1];
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevel));
+
+  for (size_t count = 1; count <= maxCount; count++)
+  {
+    level_gen_water_food_level(pLevel);
+
+    // Include some collidable tiles in the interior as well.
+    for (size_t i = 0; i < level::total / 8; i++)
+      pLevel->grid[lsGetRand() % level::total] |= tf_Collidable;
+
+    for (size_t i = 0; i < count; i++)
+    {
+      pos[i] = vec2u16(level_getRandomInteriorPosition());
+      dir[i] = (uint8_t)(lsGetRand() % _lookDirection_Count);
+    }
+
+    lsMemset(cones, LS_ARRAYSIZE(cones), (uint8_t)0xCD);
+    viewCone_get_many(*pLevel, nullptr, pos, dir, count, cones);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const viewCone expected = viewCone_get(*pLevel, pos[i], (lookDirection)dir[i]);
+      TESTABLE_ASSERT_EQUAL(memcmp(expected.values, cones[i].values, sizeof(expected.values)), 0);
+    }
+
+    TESTABLE_ASSERT_EQUAL(cones[count].values[0], 0xCD); // must not write past `count`.
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  return result;
+}
+
+DEFINE_TESTABLE(viewCone_layout_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr int32_t w = (int32_t)level::width;
+
+  // The offsets and hidden rules the default cone was originally written with.
+  constexpr int32_t expectedOffset[_lookDirection_Count][_viewConePosition_Count] = {
+    { 0, w - 1, -1, -w - 1, w - 2, -2, -w - 2, -3 },
+    { 0, -w - 1, -w, -w + 1, -w * 2 - 1, -w * 2, -w * 2 + 1, -w * 3 },
+    { 0, -w + 1, 1, w + 1, -w + 2, 2, w + 2, 3 },
+    { 0, w + 1, w, w - 1, w * 2 + 1, w * 2, w * 2 - 1, w * 3 },
+  };
+
+  constexpr uint64_t expectedOccluders[_viewConePosition_Count] = { 0, 0, 0, 0, 1 << vcp_nearLeft, 1 << vcp_nearCenter, 1 << vcp_nearRight, (1 << vcp_nearCenter) | (1 << vcp_midCenter) };
+
+  constexpr const viewCone_layout<viewCone_shape_default> &layout = viewCone_layout_of<viewCone_shape_default>;
+
+  for (size_t dir = 0; dir < _lookDirection_Count; dir++)
+    for (size_t i = 0; i < _viewConePosition_Count; i++)
+      TESTABLE_ASSERT_EQUAL(layout.tileOffset[dir][i], expectedOffset[dir][i]);
+
+  for (size_t i = 0; i < _viewConePosition_Count; i++)
+    TESTABLE_ASSERT_EQUAL(layout.occluders[i], expectedOccluders[i]);
+
+  static_assert(viewCone_shape_wedge<3>::count == 1 + 3 + 3 + 5);
+  static_assert(viewCone_layout_of<viewCone_shape_wedge<8>>.occludersInShape);
+  static_assert(viewCone_layout_of<viewCone_shape_wedge<8>>.reach == 8);
+
+  // A larger cone reaches past the walls, a wall straight ahead hides the whole center column behind it.
+  static_assert(viewCone_shape_wedge<5>::cell(vcp_nearCenter).forward == 1 && viewCone_shape_wedge<5>::cell(vcp_nearCenter).lateral == 0);
+  {
+    using wedge = viewCone_shape_wedge<5>;
+    constexpr const viewCone_layout<wedge> &wedgeLayout = viewCone_layout_of<wedge>;
+
+    level lvl;
+    lsZeroMemory(lvl.grid, LS_ARRAYSIZE(lvl.grid));
+
+    const vec2u16 pos((uint16_t)(level::width / 2), (uint16_t)(level::height / 2));
+    lvl.grid[(pos.y - 1) * level::width + pos.x] = tf_Collidable;
+
+    const viewCone_t<wedge> cone = viewCone_get<wedge>(lvl, pos, ld_up);
+
+    for (size_t i = 0; i < wedge::count; i++)
+    {
+      const viewCone_cell c = wedge::cell(i);
+      TESTABLE_ASSERT_EQUAL(wedgeLayout.tileOffset[ld_up][i], -c.forward * w + c.lateral);
+
+      if (c.forward == 1 && c.lateral == 0)
+        TESTABLE_ASSERT_EQUAL(cone[i], tf_Collidable);
+      else if (wedgeLayout.occluders[i] & (1ULL << vcp_nearCenter))
+        TESTABLE_ASSERT_EQUAL(cone[i], tf_Hidden);
+      else
+        TESTABLE_ASSERT_EQUAL(cone[i], 0);
+    }
+
+    const viewCone_t<wedge> edge = viewCone_get<wedge>(lvl, vec2u16(0, 1), ld_left);
+
+    for (size_t i = 1; i < wedge::count; i++)
+      TESTABLE_ASSERT_TRUE(!!(edge[i] & (tf_Collidable | tf_Hidden)));
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(level_occupancy_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevel = nullptr;
+  level_occupancy *pExpected = nullptr;
+  actor *pActor = nullptr;
+  actor_population population;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevel));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pExpected));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActor));
+
+  // Actors see and block each other.
+  {
+    level_initLinear(pLevel);
+
+    for (size_t i = 0; i < level::total; i++)
+      if (!(pLevel->grid[i] & tf_Collidable))
+        pLevel->grid[i] = 0;
+
+    level_occupancy_clear(pExpected);
+    level_occupancy_add(pExpected, vec2u16(10, 10));
+    level_occupancy_add(pExpected, vec2u16(12, 10));
+
+    const viewCone cone = viewCone_get(*pLevel, vec2u16(10, 10), ld_right, pExpected);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_self], 0);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_nearCenter], 0);
+    TESTABLE_ASSERT_EQUAL(cone[vcp_midCenter], tf_OtherActor);
+
+    actor_state state;
+    lsZeroMemory(&state);
+    state.pos = vec2u16(10, 10);
+    state.look_at_dir = ld_right;
+    state.stats[as_Energy] = 100;
+
+    actor_act(&state, pLevel, cone, aa_Move2, pExpected);
+    TESTABLE_ASSERT_EQUAL(state.pos, vec2u16(10, 10));
+
+    actor_act(&state, pLevel, cone, aa_Move, pExpected);
+    TESTABLE_ASSERT_EQUAL(state.pos, vec2u16(11, 10));
+    TESTABLE_ASSERT_EQUAL(pExpected->count[10 * level::width + 10], 0);
+    TESTABLE_ASSERT_EQUAL(pExpected->count[10 * level::width + 11], 1);
+  }
+
+  // The occupancy of a population is kept up to date while actors move and die.
+  for (size_t run = 0; run < 4; run++)
+  {
+    level_gen_water_food_level(pLevel);
+    actor_population_clear(&population);
+
+    for (size_t i = 0; i < 24; i++)
+    {
+      new (pActor) actor(level_getRandomFreePosition(*pLevel), (lookDirection)(lsGetRand() % _lookDirection_Count));
+      actor_initRandom(pActor);
+
+      TESTABLE_ASSERT_SUCCESS(actor_population_add(&population, *pActor));
+    }
+
+    for (size_t step = 0; step < 96; step++)
+    {
+      const size_t aliveCount = level_performStep(*pLevel, &population);
+
+      level_occupancy_clear(pExpected);
+
+      for (size_t i = 0; i < population.count; i++)
+        if (population.pStats[as_Energy][i])
+          level_occupancy_add(pExpected, population.pPos[i]);
+
+      TESTABLE_ASSERT_EQUAL(memcmp(pExpected->count, population.pOccupancy->count, sizeof(pExpected->count)), 0);
+
+      viewCone_get_many(*pLevel, population.pOccupancy, population.pPos, population.pLookDir, population.count, population.pCones);
+
+      for (size_t i = 0; i < population.count; i++)
+      {
+        const viewCone expected = viewCone_get(*pLevel, population.pPos[i], (lookDirection)population.pLookDir[i], population.pOccupancy);
+        TESTABLE_ASSERT_EQUAL(memcmp(expected.values, population.pCones[i].values, sizeof(expected.values)), 0);
+      }
+
+      // The alive bits follow the energy of the actors.
+      size_t expectedAliveCount = 0;
+
+      for (size_t i = 0; i < population.count; i++)
+      {
+        const bool alive = !!population.pStats[as_Energy][i];
+        expectedAliveCount += alive;
+
+        TESTABLE_ASSERT_EQUAL(alive, !!(population.pAliveBits[i / actor_population::capacity_granularity] & (1U << (i % actor_population::capacity_granularity))));
+      }
+
+      TESTABLE_ASSERT_EQUAL(aliveCount, expectedAliveCount);
+      TESTABLE_ASSERT_EQUAL(population.aliveCount, expectedAliveCount);
+
+      if (aliveCount == 0)
+      {
+        TESTABLE_ASSERT_EQUAL(level_performStep(*pLevel, &population), (size_t)0); // a step without any living actors is just a no-op.
+        break;
+      }
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  lsFreePtr(&pExpected);
+  lsFreeAlignedPtr(&pActor);
+  return result;
+}
+
+DEFINE_TESTABLE(level_performStep_parallel_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t actorCount = 1500;
+
+  level *pLevelA = nullptr;
+  level *pLevelB = nullptr;
+  actor *pActor = nullptr;
+  thread_pool *pThreadPool = thread_pool_new(4);
+  actor_population populationA;
+  actor_population populationB;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelA));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelB));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActor));
+
+  // Two actors that want to move onto the same tile: the lower index gets it.
+  {
+    level_initLinear(pLevelA);
+
+    for (size_t i = 0; i < level::total; i++)
+      if (!(pLevelA->grid[i] & tf_Collidable))
+        pLevelA->grid[i] = 0;
+
+    actor_population_clear(&populationA);
+
+    for (const lookDirection dir : { ld_right, ld_left })
+    {
+      new (pActor) actor(vec2u8(dir == ld_right ? 10 : 12, 10), dir);
+      lsZeroMemory(pActor->brain.values, LS_ARRAYSIZE(pActor->brain.values)); // all outputs are equal, so this always picks `aa_Move`.
+      pActor->stats[as_Air] = 255;
+      pActor->stats[as_Energy] = 255;
+
+      for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
+        pActor->stats[i] = 0;
+
+      TESTABLE_ASSERT_SUCCESS(actor_population_add(&populationA, *pActor));
+    }
+
+    level_performStep(*pLevelA, &populationA, pThreadPool);
+
+    TESTABLE_ASSERT_EQUAL(populationA.pPos[0], vec2u16(11, 10));
+    TESTABLE_ASSERT_EQUAL(populationA.pPos[1], vec2u16(12, 10));
+  }
+
+  // The result doesn't depend on the number of threads.
+  level_gen_water_food_level(pLevelA);
+  *pLevelB = *pLevelA;
+
+  actor_population_clear(&populationA);
+  actor_population_clear(&populationB);
+
+  for (size_t i = 0; i < actorCount; i++)
+  {
+    new (pActor) actor(level_getRandomFreePosition(*pLevelA), (lookDirection)(lsGetRand() % _lookDirection_Count));
+    actor_initRandom(pActor);
+
+    TESTABLE_ASSERT_SUCCESS(actor_population_add(&populationA, *pActor));
+    TESTABLE_ASSERT_SUCCESS(actor_population_add(&populationB, *pActor));
+  }
+
+  for (size_t step = 0; step < 32; step++)
+  {
+    level_performStep(*pLevelA, &populationA, pThreadPool);
+    level_performStep(*pLevelB, &populationB, nullptr);
+
+    TESTABLE_ASSERT_EQUAL(memcmp(pLevelA->grid, pLevelB->grid, sizeof(pLevelA->grid)), 0);
+    TESTABLE_ASSERT_EQUAL(memcmp(populationA.pOccupancy->count, populationB.pOccupancy->count, sizeof(populationA.pOccupancy->count)), 0);
+    TESTABLE_ASSERT_EQUAL(memcmp(populationA.pPos, populationB.pPos, sizeof(vec2u16) * populationA.count), 0);
+    TESTABLE_ASSERT_EQUAL(memcmp(populationA.pLookDir, populationB.pLookDir, populationA.count), 0);
+
+    for (size_t i = 0; i < _actorStats_Count; i++)
+      TESTABLE_ASSERT_EQUAL(memcmp(populationA.pStats[i], populationB.pStats[i], populationA.count), 0);
+  }
+
+epilogue:
+  thread_pool_destroy(&pThreadPool);
+  lsFreePtr(&pLevelA);
+  lsFreePtr(&pLevelB);
+  lsFreeAlignedPtr(&pActor);
+  return result;
+}
+
+static void level_growPlants_reference_internal(level *pLvl)
+{
+  const level previous = *pLvl;
+
+  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
+  {
+    for (size_t x = 0; x < level::width; x++)
+    {
+      const size_t i = y * level::width + x;
+      const uint8_t self = previous.grid[i];
+
+      if (self & tf_Collidable)
+        continue;
+
+      for (const auto &type : level_plant_growth_foods)
+      {
+        if (type.underwater != !!(self & tf_Underwater))
+          continue;
+
+        const uint8_t neighbours = !!(previous.grid[i - level::width] & type.food) + !!(previous.grid[i + level::width] & type.food) + !!(previous.grid[i - 1] & type.food) + !!(previous.grid[i + 1] & type.food);
+
+        if (neighbours >= level_plant_growth::neighbourThreshold)
+          pLvl->grid[i] |= type.food;
+      }
+    }
+  }
+}
+
+DEFINE_TESTABLE(level_growPlants_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevel = nullptr;
+  level *pReference = nullptr;
+  level_plant_growth *pGrowth = nullptr;
+  level_regrowth *pRegrowth = nullptr;
+  level_regrowth *pReferenceRegrowth = nullptr;
+  level_undo_log undoLog;
+  level_undo_log referenceUndoLog;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevel));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pReference));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pGrowth));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRegrowth));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pReferenceRegrowth));
+  TESTABLE_ASSERT_SUCCESS(level_undo_log_init(&undoLog));
+  TESTABLE_ASSERT_SUCCESS(level_undo_log_init(&referenceUndoLog));
+
+  // Plants grow back into an eaten tile.
+  {
+    level_gen_init(pLevel, 0);
+    level_gen_finalize(pLevel);
+
+    const size_t center = (level::height / 2) * level::width + level::width / 2;
+    pLevel->grid[center - 1] = tf_Protein;
+    pLevel->grid[center + 1] = tf_Protein;
+    pLevel->grid[center - level::width] = tf_Underwater | tf_Vitamin;
+    pLevel->grid[center + level::width] = tf_Underwater | tf_Vitamin;
+
+    level_plant_growth_init(pGrowth);
+
+    for (size_t i = 0; i < level_plant_growth::interval - 1; i++)
+      TESTABLE_ASSERT_FALSE(level_growPlants(pLevel, pGrowth));
+
+    TESTABLE_ASSERT_EQUAL(pLevel->grid[center], 0);
+    TESTABLE_ASSERT_TRUE(level_growPlants(pLevel, pGrowth));
+    TESTABLE_ASSERT_EQUAL(pLevel->grid[center], tf_Protein); // vitamin doesn't grow on land.
+
+    // Nothing grows anymore, so nothing is evaluated after this update.
+    for (size_t i = 0; i < level_plant_growth::interval - 1; i++)
+      level_growPlants(pLevel, pGrowth);
+
+    TESTABLE_ASSERT_FALSE(level_growPlants(pLevel, pGrowth));
+
+    pLevel->grid[center] = 0;
+
+    // Unmarked changes aren't seen.
+    for (size_t i = 0; i < level_plant_growth::interval; i++)
+      level_growPlants(pLevel, pGrowth);
+
+    TESTABLE_ASSERT_EQUAL(pLevel->grid[center], 0);
+
+    level_plant_growth_markTile(pGrowth, center);
+
+    for (size_t i = 0; i < level_plant_growth::interval; i++)
+      level_growPlants(pLevel, pGrowth);
+
+    TESTABLE_ASSERT_EQUAL(pLevel->grid[center], tf_Protein);
+  }
+
+  // Regrowth and undo logs mark the tiles they change, so plants spread from them.
+  for (size_t variant = 0; variant < 2; variant++)
+  {
+    level_gen_init(pLevel, 0);
+    level_gen_finalize(pLevel);
+
+    const size_t center = (level::height / 2) * level::width + level::width / 2;
+    pLevel->grid[center - 1] = tf_Protein;
+    pLevel->grid[center + 1] = tf_Protein;
+
+    // The food on the right is eaten before the plants had a chance to spread.
+    level_undo_log_clear(&undoLog);
+    level_undo_log_record(&undoLog, *pLevel, center + 1);
+    pLevel->grid[center + 1] = 0;
+
+    level_plant_growth_init(pGrowth);
+    level_regrowth_init(pRegrowth, 1);
+    level_regrowth_schedule(pRegrowth, center + 1, tf_Protein);
+
+    for (size_t i = 0; i < level_plant_growth::interval; i++)
+      TESTABLE_ASSERT_FALSE(level_growPlants(pLevel, pGrowth)); // a single plant doesn't spread.
+
+    if (variant == 0)
+      TESTABLE_ASSERT_EQUAL(level_regrowth_advance(pRegrowth, pLevel, nullptr, pGrowth), (size_t)1);
+    else
+      level_undo_log_restore(&undoLog, pLevel, pGrowth);
+
+    TESTABLE_ASSERT_EQUAL(pLevel->grid[center + 1], tf_Protein);
+
+    for (size_t i = 0; i < level_plant_growth::interval; i++)
+      level_growPlants(pLevel, pGrowth);
+
+    TESTABLE_ASSERT_EQUAL(pLevel->grid[center], tf_Protein);
+  }
+
+  // Skipping unchanged rows doesn't change the result, no matter if the tiles were changed by eating, regrowth or undo logs in between.
+  for (size_t run = 0; run < 8; run++)
+  {
+    level_gen_water_food_level(pLevel);
+    *pReference = *pLevel;
+
+    level_plant_growth_init(pGrowth);
+    level_regrowth_init(pRegrowth, 1);
+    level_regrowth_init(pReferenceRegrowth, 1);
+    level_undo_log_clear(&undoLog);
+    level_undo_log_clear(&referenceUndoLog);
+
+    for (size_t update = 0; update < 32; update++)
+    {
+      for (size_t i = 0; i < level_plant_growth::interval; i++)
+        level_growPlants(pLevel, pGrowth);
+
+      level_growPlants_reference_internal(pReference);
+
+      TESTABLE_ASSERT_EQUAL(memcmp(pLevel->grid, pReference->grid, sizeof(pLevel->grid)), 0);
+
+      // The food that was eaten in the last update grows back.
+      level_regrowth_advance(pRegrowth, pLevel, &undoLog, pGrowth);
+      level_regrowth_advance(pReferenceRegrowth, pReference, &referenceUndoLog);
+
+      if (update % 4 == 3)
+      {
+        level_undo_log_restore(&undoLog, pLevel, pGrowth);
+        level_undo_log_restore(&referenceUndoLog, pReference);
+        continue;
+      }
+
+      for (size_t i = 0; i < 4; i++)
+      {
+        const size_t index = lsGetRand() % level::total;
+        const uint8_t food = (uint8_t)(pLevel->grid[index] & (tf_Protein | tf_Sugar | tf_Vitamin | tf_Fat));
+
+        level_undo_log_record(&undoLog, *pLevel, index);
+        level_undo_log_record(&referenceUndoLog, *pReference, index);
+
+        pLevel->grid[index] &= ~food;
+        pReference->grid[index] &= ~food;
+        level_plant_growth_markTile(pGrowth, index);
+
+        if (food != 0)
+        {
+          level_regrowth_schedule(pRegrowth, index, (tileFlag)(1 << lsLowestBit((uint32_t)food)));
+          level_regrowth_schedule(pReferenceRegrowth, index, (tileFlag)(1 << lsLowestBit((uint32_t)food)));
+        }
+      }
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  lsFreePtr(&pReference);
+  lsFreePtr(&pGrowth);
+  lsFreePtr(&pRegrowth);
+  lsFreePtr(&pReferenceRegrowth);
+  return result;
+}
+
+DEFINE_TESTABLE(level_regrowth_test)
+{
+  lsResult result = lsR_Success;
+
+  struct pending_food
+  {
+    uint32_t dueStep;
+    uint16_t tileIndex;
+    tileFlag food;
+  };
+
+  level *pLevel = nullptr;
+  level *pReference = nullptr;
+  level_regrowth *pRegrowth = nullptr;
+  level_regrowth *pReadRegrowth = nullptr;
+  std::vector<pending_food> pending;
+
+  constexpr tileFlag foods[] = { tf_Protein, tf_Sugar, tf_Vitamin, tf_Fat };
+  constexpr uint32_t delays[] = { 1, 7, level_regrowth::slotCount, 100, 5000 };
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevel));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pReference));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRegrowth));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pReadRegrowth));
+
+  for (const uint32_t delay : delays)
+  {
+    level_gen_water_food_level(pLevel);
+    *pReference = *pLevel;
+
+    level_regrowth_init(pRegrowth, delay);
+    pending.clear();
+
+    for (uint32_t step = 1; step <= 12000; step++)
+    {
+      TESTABLE_ASSERT_EQUAL(level_regrowth_advance(pRegrowth, pLevel), (size_t)std::count_if(pending.begin(), pending.end(), [=](const pending_food &p) { return p.dueStep == step; }));
+
+      for (const pending_food &p : pending)
+        if (p.dueStep == step)
+          pReference->grid[p.tileIndex] |= p.food;
+
+      std::erase_if(pending, [=](const pending_food &p) { return p.dueStep == step; });
+
+      TESTABLE_ASSERT_EQUAL(memcmp(pLevel->grid, pReference->grid, sizeof(pLevel->grid)), 0);
+      TESTABLE_ASSERT_EQUAL(pRegrowth->pendingCount, pending.size());
+
+      // Eat some food.
+      for (size_t i = 0; i < 3; i++)
+      {
+        const uint16_t tileIndex = (uint16_t)(lsGetRand() % level::total);
+        const tileFlag food = foods[lsGetRand() % LS_ARRAYSIZE(foods)];
+
+        if (!(pLevel->grid[tileIndex] & food))
+          continue;
+
+        pLevel->grid[tileIndex] &= ~food;
+        pReference->grid[tileIndex] &= ~food;
+
+        level_regrowth_schedule(pRegrowth, tileIndex, food);
+        pending.push_back({ step + delay, tileIndex, food });
+      }
+
+      // Checkpoint the level and the pending food and continue from the checkpoint.
+      if (step % 3001 == 0)
+      {
+        lsCreateDirectory("_test");
+        const char filename[] = "_test/level_regrowth_test";
+
+        {
+          cached_file_byte_stream_writer<> write_stream;
+          TESTABLE_ASSERT_SUCCESS(write_byte_stream_init(write_stream, filename));
+
+          value_writer<decltype(write_stream)> writer;
+          TESTABLE_ASSERT_SUCCESS(value_writer_init(writer, &write_stream));
+
+          TESTABLE_ASSERT_SUCCESS(level_write(*pLevel, writer));
+          TESTABLE_ASSERT_SUCCESS(level_regrowth_write(*pRegrowth, writer));
+          TESTABLE_ASSERT_SUCCESS(write_byte_stream_flush(write_stream));
+        }
+
+        lsZeroMemory(pLevel);
+
+        {
+          cached_file_byte_stream_reader<> read_stream;
+          TESTABLE_ASSERT_SUCCESS(read_byte_stream_init(read_stream, filename));
+
+          value_reader<decltype(read_stream)> reader;
+          TESTABLE_ASSERT_SUCCESS(value_reader_init(reader, &read_stream));
+
+          TESTABLE_ASSERT_SUCCESS(level_read(*pLevel, reader));
+          TESTABLE_ASSERT_SUCCESS(level_regrowth_read(*pReadRegrowth, reader));
+          read_byte_stream_destroy(read_stream);
+        }
+
+        TESTABLE_ASSERT_EQUAL(memcmp(pLevel->grid, pReference->grid, sizeof(pLevel->grid)), 0);
+        TESTABLE_ASSERT_EQUAL(pReadRegrowth->pendingCount, pRegrowth->pendingCount);
+        TESTABLE_ASSERT_EQUAL(pReadRegrowth->currentStep, pRegrowth->currentStep);
+
+        std::swap(pRegrowth, pReadRegrowth);
+      }
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  lsFreePtr(&pReference);
+  lsFreePtr(&pRegrowth);
+  lsFreePtr(&pReadRegrowth);
+  return result;
+}
+
+DEFINE_TESTABLE(level_undo_log_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t actorCount = 64;
+
+  level *pLevel = nullptr;
+  level *pTemplate = nullptr;
+  actor *pActor = nullptr;
+  level_regrowth *pRegrowth = nullptr;
+  thread_pool *pThreadPool = thread_pool_new(4);
+  level_undo_log undoLog;
+  actor_population population;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevel));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pTemplate));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActor));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRegrowth));
+  TESTABLE_ASSERT_SUCCESS(level_undo_log_init(&undoLog));
+
+  level_gen_water_food_level(pTemplate);
+  *pLevel = *pTemplate;
+
+  // The same level is reused for every episode, only the changed tiles are restored in between.
+  for (size_t episode = 0; episode < 8; episode++)
+  {
+    level_plant_growth growth;
+    level_plant_growth_init(&growth);
+    level_regrowth_init(pRegrowth, 3);
+
+    level_step_options options;
+    options.pGrowth = &growth;
+    options.pRegrowth = pRegrowth;
+    options.pUndoLog = &undoLog;
+
+    actor_population_clear(&population);
+
+    for (size_t i = 0; i < actorCount; i++)
+    {
+      new (pActor) actor(level_getRandomFreePosition(*pLevel), (lookDirection)(lsGetRand() % _lookDirection_Count));
+
+      actor_initRandom(pActor);
+      TESTABLE_ASSERT_SUCCESS(actor_population_add(&population, *pActor));
+    }
+
+    for (size_t step = 0; step < 128; step++)
+    {
+      if (episode & 1)
+        level_performStep(*pLevel, pActor, 1, options); // the last actor on its own.
+      else
+        level_performStep(*pLevel, &population, pThreadPool, options);
+    }
+
+    // Every tile that differs from the template has to be in the log.
+    for (size_t i = 0; i < level::total; i++)
+      if (pLevel->grid[i] != pTemplate->grid[i])
+        TESTABLE_ASSERT_TRUE(!!(undoLog.pRecorded[i / 64] & (1ULL << (i % 64))));
+
+    level_undo_log_restore(&undoLog, pLevel);
+
+    TESTABLE_ASSERT_EQUAL(undoLog.count, 0ULL);
+    TESTABLE_ASSERT_EQUAL(memcmp(pLevel->grid, pTemplate->grid, sizeof(pLevel->grid)), 0);
+
+    for (size_t i = 0; i < (level::total + 63) / 64; i++)
+      TESTABLE_ASSERT_EQUAL(undoLog.pRecorded[i], 0ULL);
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  lsFreePtr(&pTemplate);
+  lsFreeAlignedPtr(&pActor);
+  lsFreePtr(&pRegrowth);
+  thread_pool_destroy(&pThreadPool);
+  return result;
+}
+
+DEFINE_TESTABLE(level_bitplanes_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevel = nullptr;
+  level_bitplanes *pPlanes = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevel));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pPlanes));
+
+  for (size_t run = 0; run < 8; run++)
+  {
+    if (run == 0)
+      for (size_t i = 0; i < level::total; i++)
+        pLevel->grid[i] = (uint8_t)lsGetRand(); // all bits, even the ones that aren't on the map.
+    else
+      level_gen_water_food_level(pLevel);
+
+    level_bitplanes_build(pPlanes, *pLevel);
+
+    for (size_t bit = 0; bit < 8; bit++)
+    {
+      size_t expectedCount = 0;
+
+      for (size_t i = 0; i < level::total; i++)
+      {
+        const bool set = !!(pLevel->grid[i] & (1 << bit));
+        expectedCount += set;
+        TESTABLE_ASSERT_EQUAL(!!(level_bitplanes_get(*pPlanes, (tileFlag)(1 << bit)).words[i / 64] & (1ULL << (i % 64))), set);
+      }
+
+      TESTABLE_ASSERT_EQUAL(level_bitplane_count(pPlanes->planes[bit]), expectedCount);
+    }
+
+    // Underwater tiles next to food.
+    level_bitplane food, nextToFood;
+    level_bitplanes_any(*pPlanes, tf_Protein | tf_Sugar | tf_Vitamin | tf_Fat, &food);
+    level_bitplane_neighbours(food, &nextToFood);
+    level_bitplane_and(nextToFood, level_bitplanes_get(*pPlanes, tf_Underwater), &nextToFood);
+
+    // Land tiles without food.
+    level_bitplane landWithoutFood;
+    level_bitplane_or(food, level_bitplanes_get(*pPlanes, tf_Underwater), &landWithoutFood);
+
+    level_bitplane everything;
+    lsMemset(everything.words, level_bitplane::word_count, 0xFF);
+    level_bitplane_andNot(everything, landWithoutFood, &landWithoutFood);
+
+    constexpr uint8_t foodMask = tf_Protein | tf_Sugar | tf_Vitamin | tf_Fat;
+
+    for (size_t y = 0; y < level::height; y++)
+    {
+      for (size_t x = 0; x < level::width; x++)
+      {
+        const size_t i = y * level::width + x;
+
+        bool expected = false;
+
+        if (pLevel->grid[i] & tf_Underwater)
+        {
+          expected |= x > 0 && (pLevel->grid[i - 1] & foodMask);
+          expected |= x + 1 < level::width && (pLevel->grid[i + 1] & foodMask);
+          expected |= y > 0 && (pLevel->grid[i - level::width] & foodMask);
+          expected |= y + 1 < level::height && (pLevel->grid[i + level::width] & foodMask);
+        }
+
+        TESTABLE_ASSERT_EQUAL(!!(nextToFood.words[i / 64] & (1ULL << (i % 64))), expected);
+        TESTABLE_ASSERT_EQUAL(!!(landWithoutFood.words[i / 64] & (1ULL << (i % 64))), !(pLevel->grid[i] & (foodMask | tf_Underwater)));
+      }
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  lsFreeAlignedPtr(&pPlanes);
+  return result;
+}
+
+DEFINE_TESTABLE(level_sizes_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pSmall = nullptr;
+  level_128 *pLarge = nullptr;
+  level_1024 *pHuge = nullptr;
+  actor *pSmallActors = nullptr;
+  actor *pHugeActors = nullptr;
+  level_occupancy_t<level_1024> *pHugeOccupancy = nullptr;
+  level_step_options_t<level_1024> hugeOptions;
+
+  constexpr size_t actorCount = 8;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pSmall));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLarge));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pHuge));
+  TESTABLE_ASSERT_SUCCESS(lsAllocZero(&pHugeOccupancy));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pSmallActors, actorCount));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pHugeActors, actorCount));
+
+  // The larger levels generate just as well.
+  level_gen_water_food_level(pHuge);
+
+  for (size_t i = 0; i < level_1024::width; i++)
+    TESTABLE_ASSERT_EQUAL(pHuge->grid[level_1024::width * (level_1024::height - 1) + i], tf_Collidable);
+
+  for (size_t run = 0; run < 4; run++)
+  {
+    // Place a small level in the top left corner of a large one, everything around it is collidable.
+    level_gen_water_food_level(pSmall);
+    level_gen_fill(pLarge, tf_Collidable);
+
+    for (size_t y = 0; y < level::height; y++)
+      lsMemcpy(pLarge->grid + y * level_128::width, pSmall->grid + y * level::width, level::width);
+
+    level_gen_grow_into_mask(pSmall, 0, tf_Underwater);
+    level_gen_grow_into_mask(pLarge, 0, tf_Underwater);
+
+    for (size_t y = 0; y < level::height; y++)
+      TESTABLE_ASSERT_EQUAL(memcmp(pLarge->grid + y * level_128::width, pSmall->grid + y * level::width, level::width), 0);
+
+    for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
+    {
+      for (size_t x = level::wallThickness; x < level::width - level::wallThickness; x++)
+      {
+        if (pSmall->grid[y * level::width + x] & tf_Collidable)
+          continue;
+
+        for (size_t dir = 0; dir < _lookDirection_Count; dir++)
+        {
+          const viewCone smallCone = viewCone_get<viewCone_shape_default>(*pSmall, vec2u16(x, y), (lookDirection)dir);
+          const viewCone largeCone = viewCone_get<viewCone_shape_default>(*pLarge, vec2u16(x, y), (lookDirection)dir);
+          TESTABLE_ASSERT_EQUAL(memcmp(smallCone.values, largeCone.values, sizeof(smallCone.values)), 0);
+
+          actor_state smallActor;
+          lsZeroMemory(&smallActor);
+          smallActor.pos = vec2u16(x, y);
+          smallActor.look_at_dir = (lookDirection)dir;
+          smallActor.stats[as_Energy] = 128;
+
+          actor_state largeActor = smallActor;
+
+          if (x % 2)
+          {
+            actor_move(&smallActor, *pSmall);
+            actor_move(&largeActor, *pLarge);
+          }
+          else
+          {
+            actor_moveTwo(&smallActor, *pSmall);
+            actor_moveTwo(&largeActor, *pLarge);
+          }
+
+          TESTABLE_ASSERT_EQUAL(smallActor.pos, largeActor.pos);
+          TESTABLE_ASSERT_EQUAL(smallActor.stats[as_Energy], largeActor.stats[as_Energy]);
+        }
+      }
+    }
+  }
+
+  // Actors step the same on a small level placed somewhere in the middle of a huge one, alone (without occupancy) and together (with an occupancy that's reused for every step).
+  hugeOptions.pOccupancy = pHugeOccupancy;
+
+  for (size_t run = 0; run < 4; run++)
+  {
+    const vec2u16 offset = vec2u16(500 + run * 97, 300 + run * 131);
+    const size_t count = (run % 2) ? actorCount : 1;
+
+    level_gen_water_food_level(pSmall);
+    level_gen_fill(pHuge, tf_Collidable);
+
+    for (size_t y = 0; y < level::height; y++)
+      lsMemcpy(pHuge->grid + (offset.y + y) * level_1024::width + offset.x, pSmall->grid + y * level::width, level::width);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      new (&pSmallActors[i]) actor(level_getRandomFreePosition(*pSmall), (lookDirection)(lsGetRand() % _lookDirection_Count));
+      actor_initRandom(&pSmallActors[i]);
+
+      pHugeActors[i] = pSmallActors[i];
+      pHugeActors[i].pos += offset;
+    }
+
+    for (size_t step = 0; step < 64; step++)
+    {
+      const size_t smallAliveCount = level_performStep(*pSmall, pSmallActors, count);
+      const size_t hugeAliveCount = level_performStep(*pHuge, pHugeActors, count, (run % 2) ? hugeOptions : level_step_options_t<level_1024>());
+      TESTABLE_ASSERT_EQUAL(smallAliveCount, hugeAliveCount);
+
+      for (size_t i = 0; i < count; i++)
+      {
+        TESTABLE_ASSERT_EQUAL(pSmallActors[i].pos + offset, pHugeActors[i].pos);
+        TESTABLE_ASSERT_EQUAL(pSmallActors[i].look_at_dir, pHugeActors[i].look_at_dir);
+        TESTABLE_ASSERT_EQUAL(memcmp(pSmallActors[i].stats, pHugeActors[i].stats, sizeof(pSmallActors[i].stats)), 0);
+      }
+
+      if (smallAliveCount == 0)
+        break;
+    }
+
+    for (size_t y = 0; y < level::height; y++)
+      TESTABLE_ASSERT_EQUAL(memcmp(pHuge->grid + (offset.y + y) * level_1024::width + offset.x, pSmall->grid + y * level::width, level::width), 0);
+  }
+
+  // The step leaves the occupancy empty again.
+  TESTABLE_ASSERT_TRUE(std::all_of(pHugeOccupancy->count, pHugeOccupancy->count + LS_ARRAYSIZE(pHugeOccupancy->count), [](const uint16_t c) { return c == 0; }));
+
+epilogue:
+  lsFreePtr(&pSmall);
+  lsFreePtr(&pLarge);
+  lsFreePtr(&pHuge);
+  lsFreePtr(&pHugeOccupancy);
+  lsFreeAlignedPtr(&pSmallActors);
+  lsFreeAlignedPtr(&pHugeActors);
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "benchmark.h"
+#include "episode.h"
+
+DEFINE_BENCHMARK(viewCone_get)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t positionCount = 256;
+
+  level *pLevel = nullptr;
+  vec2u8 positions[positionCount];
+  lookDirection directions[positionCount];
+
+  LS_ERROR_CHECK(lsAlloc(&pLevel));
+  level_gen_water_food_level(pLevel);
+
+  for (size_t i = 0; i < positionCount; i++)
+  {
+    positions[i] = level_getRandomFreePosition(*pLevel);
+    directions[i] = (lookDirection)(lsGetRand() % _lookDirection_Count);
+  }
+
+  for (size_t i = 0; benchmark_keepRunning(pState); i++)
+  {
+    const viewCone cone = viewCone_get(*pLevel, vec2u16(positions[i % positionCount]), directions[i % positionCount]);
+    benchmark_doNotOptimize(cone);
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  return result;
+}
+
+DEFINE_BENCHMARK(actor_updateStats_1024)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t actorCount = 1024;
+
+  actor_population population;
+
+  LS_ERROR_CHECK(actor_population_reserve(&population, actorCount));
+  population.count = actorCount;
+
+  for (size_t i = 0; i < actorCount; i++)
+  {
+    for (size_t j = 0; j < _actorStats_Count; j++)
+      population.pStats[j][i] = (uint8_t)lsGetRand();
+
+    for (size_t j = 0; j < viewCone::count; j++)
+      population.pCones[i].values[j] = (uint8_t)(lsGetRand() & ~tf_Collidable);
+  }
+
+  pState->itemsPerIteration = actorCount;
+
+  while (benchmark_keepRunning(pState))
+  {
+    lsMemset(population.pStats[as_Energy], actorCount, 255); // keep every actor alive.
+    actor_updateStats(&population, population.pCones);
+    benchmark_clobberMemory();
+  }
+
+epilogue:
+  return result;
+}
+
+DEFINE_BENCHMARK(actor_encodeInputs)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t inputCount = 256;
+
+  viewCone *pCones = nullptr;
+  uint8_t (*pStats)[_actorStats_Count] = nullptr;
+  decltype(actor::brain)::io_buffer_t ioBuffer;
+
+  LS_ERROR_CHECK(lsAlloc(&pCones, inputCount));
+  LS_ERROR_CHECK(lsAlloc(&pStats, inputCount));
+
+  for (size_t i = 0; i < inputCount; i++)
+  {
+    for (size_t j = 0; j < viewCone::count; j++)
+      pCones[i].values[j] = (uint8_t)lsGetRand();
+
+    for (size_t j = 0; j < _actorStats_Count; j++)
+      pStats[i][j] = (uint8_t)lsGetRand();
+  }
+
+  for (size_t i = 0; benchmark_keepRunning(pState); i++)
+  {
+    actor_encodeInputs(ioBuffer, pCones[i % inputCount], pStats[i % inputCount]);
+    benchmark_doNotOptimize(ioBuffer);
+  }
+
+epilogue:
+  lsFreePtr(&pCones);
+  lsFreePtr(&pStats);
+  return result;
+}
+
+DEFINE_BENCHMARK(neural_net_eval)
+{
+  lsResult result = lsR_Success;
+
+  actor *pActor = nullptr;
+  decltype(actor::brain)::io_buffer_t input;
+  decltype(actor::brain)::io_buffer_t ioBuffer;
+
+  LS_ERROR_CHECK(lsAllocAligned(&pActor));
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(pActor->brain.values); i++)
+    pActor->brain.values[i] = (int8_t)lsGetRand();
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(input.data); i++)
+    input.data[i] = (int8_t)lsGetRand();
+
+  while (benchmark_keepRunning(pState))
+  {
+    ioBuffer = input; // evaluated in place.
+    neural_net_eval(pActor->brain, ioBuffer);
+    benchmark_doNotOptimize(ioBuffer);
+  }
+
+epilogue:
+  lsFreeAlignedPtr(&pActor);
+  return result;
+}
+
+static lsResult benchmark_level_performStep_internal(benchmark_state *pState, const size_t actorCount)
+{
+  lsResult result = lsR_Success;
+
+  // Every so often the eaten food and the actors are reset, so all samples measure the same kind of steps instead of an ever emptier level.
+  constexpr size_t restoreInterval = 64;
+
+  level *pLevel = nullptr;
+  actor *pActor = nullptr;
+  actor_state *pStates = nullptr;
+  actor_population population;
+  level_undo_log undoLog;
+  level_step_options options;
+
+  LS_ERROR_CHECK(lsAlloc(&pLevel));
+  LS_ERROR_CHECK(lsAllocAligned(&pActor));
+  LS_ERROR_CHECK(lsAlloc(&pStates, actorCount));
+  LS_ERROR_CHECK(level_undo_log_init(&undoLog));
+
+  level_gen_water_food_level(pLevel);
+
+  for (size_t i = 0; i < actorCount; i++)
+  {
+    new (pActor) actor(level_getRandomFreePosition(*pLevel), (lookDirection)(lsGetRand() % _lookDirection_Count));
+    actor_initRandom(pActor);
+
+    LS_ERROR_CHECK(actor_population_add(&population, *pActor));
+    pStates[i] = *pActor;
+  }
+
+  options.pUndoLog = &undoLog;
+  pState->itemsPerIteration = actorCount;
+
+  for (size_t i = 0; benchmark_keepRunning(pState); i++)
+  {
+    if (i % restoreInterval == restoreInterval - 1)
+    {
+      benchmark_pauseTiming(pState);
+      level_undo_log_restore(&undoLog, pLevel);
+      LS_ERROR_CHECK(actor_population_restoreStates(&population, pStates, actorCount));
+      benchmark_resumeTiming(pState);
+    }
+
+    lsMemset(population.pStats[as_Energy], actorCount, 255); // keep every actor alive.
+    level_performStep(*pLevel, &population, nullptr, options);
+    benchmark_clobberMemory();
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  lsFreeAlignedPtr(&pActor);
+  lsFreePtr(&pStates);
+  return result;
+}
+
+DEFINE_BENCHMARK(level_performStep_1)
+{
+  return benchmark_level_performStep_internal(pState, 1);
+}
+
+DEFINE_BENCHMARK(level_performStep_64)
+{
+  return benchmark_level_performStep_internal(pState, 64);
+}
+
+DEFINE_BENCHMARK(level_performStep_1024)
+{
+  return benchmark_level_performStep_internal(pState, 1024);
+}
+
+DEFINE_BENCHMARK(level_gen_water_food_level)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevel = nullptr;
+
+  LS_ERROR_CHECK(lsAlloc(&pLevel));
+
+  while (benchmark_keepRunning(pState))
+  {
+    level_gen_water_food_level(pLevel);
+    benchmark_clobberMemory();
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  return result;
+}
+
+static episode_runner *_pBenchmarkRunner = nullptr; // `evolution_init` only takes a function pointer.
+
+static size_t benchmark_evolution_eval_internal(const actor &a)
+{
+  return episode_runner_eval(*_pBenchmarkRunner, a);
+}
+
+DEFINE_BENCHMARK(evolution_generation)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t levelCount = 2;
+  constexpr size_t positionCount = 4;
+  constexpr lookDirection directions[] = { ld_left, ld_up, ld_right, ld_down };
+
+  level *pLevels = nullptr;
+  actor *pActor = nullptr;
+  const level *ppLevels[levelCount];
+  vec2u8 positions[positionCount];
+  episode_runner runner;
+  evolution<actor, proto_config> evolver;
+
+  LS_ERROR_CHECK(lsAlloc(&pLevels, levelCount));
+  LS_ERROR_CHECK(lsAllocAligned(&pActor));
+
+  for (size_t i = 0; i < levelCount; i++)
+  {
+    level_gen_water_food_level(&pLevels[i]);
+    ppLevels[i] = &pLevels[i];
+  }
+
+  // The start positions have to be free on all levels.
+  for (size_t i = 0; i < positionCount; i++)
+  {
+    bool blocked;
+
+    do
+    {
+      positions[i] = level_getRandomFreePosition(pLevels[0]);
+
+      blocked = false;
+
+      for (size_t j = 1; j < levelCount; j++)
+        blocked |= !!(pLevels[j].grid[positions[i].y * level::width + positions[i].x] & tf_Collidable);
+    } while (blocked);
+  }
+
+  LS_ERROR_CHECK(episode_runner_addScenarios(&runner, ppLevels, levelCount, positions, positionCount, directions, LS_ARRAYSIZE(directions)));
+  runner.maxSteps = 256;
+  runner.lockstep = true;
+  _pBenchmarkRunner = &runner;
+
+  new (pActor) actor(positions[0], ld_up);
+  actor_initRandom(pActor);
+
+  LS_ERROR_CHECK(evolution_init(evolver, *pActor, benchmark_evolution_eval_internal));
+
+  pState->itemsPerIteration = proto_config::newGenesPerGeneration;
+
+  while (benchmark_keepRunning(pState))
+    evolution_generation(evolver, benchmark_evolution_eval_internal);
+
+epilogue:
+  _pBenchmarkRunner = nullptr;
+  lsFreePtr(&pLevels);
+  lsFreeAlignedPtr(&pActor);
+  return result;
+}
@@ -39,23 +39,507 @@ void tileFlag_print(const uint8_t flag);
 
 //////////////////////////////////////////////////////////////////////////
 
-struct level
+// The dimensions are compile time constants, so stencils, offsets and bounds checks of every size are specialized.
+template <size_t width_, size_t height_>
+struct level_t
 {
-  static constexpr size_t width = 32;
-  static constexpr size_t height = 32;
+  static constexpr size_t width = width_;
+  static constexpr size_t height = height_;
   static constexpr size_t total = width * height;
 
   static constexpr uint8_t wallThickness = 3; // this needs a shorter name
 
+  static_assert(width > wallThickness * 2 && height > wallThickness * 2);
+  static_assert(width <= lsMaxValue<uint16_t>() && height <= lsMaxValue<uint16_t>()); // positions are `vec2u16`.
+
   uint8_t grid[width * height];
 };
 
+using level = level_t<32, 32>;
+using level_128 = level_t<128, 128>;
+using level_1024 = level_t<1024, 1024>;
+
+// The level generator, `viewCone_get`, the actor movement and the single actor step (`level_performStep` with `actor *`, `actor_act`) are available for all of these sizes.
+// Everything else (populations, lockstep batches, plant growth, regrowth, undo logs, replays, ...) works on `level`.
+#define LEVEL_FOR_EACH_SIZE(macro) \
+  macro(level) \
+  macro(level_128) \
+  macro(level_1024)
+
+// Same as `LEVEL_FOR_EACH_SIZE`, with an additional argument.
+#define LEVEL_FOR_EACH_SIZE_WITH(macro, arg) \
+  macro(level, arg) \
+  macro(level_128, arg) \
+  macro(level_1024, arg)
+
+// All values of a rule set as `(type, name, default value)`, `actor_rules_tag` is derived from all of them.
+#define ACTOR_RULES_FOR_EACH_VALUE(macro) \
+  macro(int64_t, IdleEnergyCost, 2) \
+  macro(int64_t, UnderwaterAirCost, 5) \
+  macro(int64_t, SurfaceAirAmount, 3) \
+  macro(int64_t, NoAirEnergyCost, 8) \
+  macro(int64_t, FoodEnergyAmount, 5) \
+  macro(int64_t, FoodDigestionAmount, 1) \
+  macro(int64_t, MovementEnergyCost, 10) \
+  macro(int64_t, DoubleMovementEnergyCost, 30) \
+  macro(int64_t, CollideEnergyCost, 4) \
+  macro(int64_t, TurnEnergy, 2) \
+  macro(int64_t, EatEnergyCost, 3) \
+  macro(int64_t, FoodAmount, 2) \
+  macro(uint8_t, StomachCapacity, 255)
+
+// The costs and amounts of the simulation rules. The step and act functions take the rule set as a template parameter, so every rule set is compiled into its own constant folded kernels.
+// The functions are instantiated for all `ACTOR_RULES_FOR_EACH` rule sets, new rule sets have to be added there to be used outside of `darwinwin.cpp`. Other rule sets derive from `actor_rules_default` and override values by name.
+struct actor_rules_default
+{
+#define ACTOR_RULES_DECLARE_VALUE(type, name, value) static constexpr type name = value;
+  ACTOR_RULES_FOR_EACH_VALUE(ACTOR_RULES_DECLARE_VALUE)
+#undef ACTOR_RULES_DECLARE_VALUE
+};
+
+#define ACTOR_RULES_FOR_EACH(macro) \
+  macro(actor_rules_default)
+
+// Identifies a rule set in files that are only valid for the rules they were recorded with (like replays). Derived from the values, so rule sets that behave the same share a tag.
+template <typename rules>
+constexpr uint64_t actor_rules_tag()
+{
+#define ACTOR_RULES_TAG_VALUE(type, name, value) (int64_t)rules::name,
+  const int64_t values[] = { ACTOR_RULES_FOR_EACH_VALUE(ACTOR_RULES_TAG_VALUE) };
+#undef ACTOR_RULES_TAG_VALUE
+
+  // FNV-1a.
+  uint64_t hash = 0xcbf29ce484222325;
+
+  for (const int64_t value : values)
+  {
+    for (size_t i = 0; i < sizeof(value); i++)
+    {
+      hash ^= (uint8_t)((uint64_t)value >> (i * 8));
+      hash *= 0x100000001b3;
+    }
+  }
+
+  return hash;
+}
+
 void level_initLinear(level *pLevel);
 void level_print(const level &level);
 
+// Uniformly random positions inside the walls. The free one retries until it isn't `tf_Collidable`, so the level needs at least one free interior tile.
+vec2u8 level_getRandomInteriorPosition();
+vec2u8 level_getRandomFreePosition(const level &lvl);
+
 struct actor;
 
-bool level_performStep(level &lvl, actor *pActors, const size_t actorCount);
+struct level_plant_growth;
+struct level_regrowth;
+struct level_replay_writer;
+
+inline void level_plant_growth_markTile(level_plant_growth *pGrowth, const size_t tileIndex);
+
+template <typename level_type>
+struct level_undo_log_t;
+
+using level_undo_log = level_undo_log_t<level>;
+
+template <typename level_type>
+struct level_occupancy_t;
+
+// Optional systems that take part in a level step, the ones that are `nullptr` are skipped.
+// Plant growth, food regrowth, undo logs and replays only exist for `level` (the growth evaluates a row as one AVX2 vector), so they can't be set when stepping levels of other sizes.
+template <typename level_type>
+struct level_step_options_t
+{
+  level_occupancy_t<level_type> *pOccupancy = nullptr; // tracks the actors of the `actor` array step. Has to be empty and is empty again after the step. Required for multiple actors if the occupancy is too large for the stack.
+};
+
+template <>
+struct level_step_options_t<level>
+{
+  level_plant_growth *pGrowth = nullptr; // the plants grow before the actors are stepped.
+  level_regrowth *pRegrowth = nullptr; // eaten food is scheduled to grow back, due food grows back before the actors are stepped.
+  level_undo_log *pUndoLog = nullptr; // the original value of every tile that is changed is recorded, so the level can be restored.
+  level_replay_writer *pReplay = nullptr; // the actions of all actors are appended to the replay log (only used by the `actor_population` step).
+  const uint8_t *pReplayedActions = nullptr; // one `actorAction` per actor, used instead of evaluating the brains (only used by the `actor_population` step).
+  level_occupancy_t<level> *pOccupancy = nullptr; // tracks the actors of the `actor` array step. Has to be empty and is empty again after the step.
+};
+
+using level_step_options = level_step_options_t<level>;
+
+// Returns the number of actors that still have energy left after the step. Instantiated for all `LEVEL_FOR_EACH_SIZE` levels and `ACTOR_RULES_FOR_EACH` rule sets.
+template <typename rules = actor_rules_default, typename level_type>
+size_t level_performStep(level_type &lvl, actor *pActors, const size_t actorCount, const std::type_identity_t<level_step_options_t<level_type>> &options = {});
+
+// Number of living actors on every tile of a level, kept next to `level::grid` so `tf_OtherActor` and actor collisions can be looked up per tile.
+template <typename level_type>
+struct level_occupancy_t
+{
+  uint16_t count[level_type::total + 1]; // one extra entry, so 32 bit gathers of the last tile stay in bounds.
+};
+
+using level_occupancy = level_occupancy_t<level>;
+
+template <typename level_type>
+inline void level_occupancy_clear(level_occupancy_t<level_type> *pOccupancy)
+{
+  lsZeroMemory(pOccupancy->count, LS_ARRAYSIZE(pOccupancy->count));
+}
+
+template <typename level_type>
+inline void level_occupancy_add(level_occupancy_t<level_type> *pOccupancy, const vec2u16 pos)
+{
+  lsAssert(pos.x < level_type::width && pos.y < level_type::height);
+  lsAssert(pOccupancy->count[pos.y * level_type::width + pos.x] < lsMaxValue<uint16_t>());
+  pOccupancy->count[pos.y * level_type::width + pos.x]++;
+}
+
+template <typename level_type>
+inline void level_occupancy_remove(level_occupancy_t<level_type> *pOccupancy, const vec2u16 pos)
+{
+  lsAssert(pos.x < level_type::width && pos.y < level_type::height);
+  lsAssert(pOccupancy->count[pos.y * level_type::width + pos.x] > 0);
+  pOccupancy->count[pos.y * level_type::width + pos.x]--;
+}
+
+// The original values of all tiles that were changed since the log was last restored or cleared, so a level can be reset to its template in O(changed tiles) instead of copying the whole level.
+// Only the first change of every tile is recorded, so the log never holds more than `level_type::total` entries and recording never allocates.
+template <typename level_type>
+struct level_undo_log_t
+{
+  uint32_t *pTileIndices = nullptr;
+  uint8_t *pOriginalValues = nullptr;
+  uint64_t *pRecorded = nullptr; // one bit per tile.
+  size_t count = 0;
+
+  inline level_undo_log_t() {};
+  inline level_undo_log_t(const level_undo_log_t &) = delete;
+  level_undo_log_t &operator =(const level_undo_log_t &) = delete;
+
+  inline ~level_undo_log_t()
+  {
+    level_undo_log_destroy(this);
+  }
+};
+
+template <typename level_type>
+inline void level_undo_log_destroy(level_undo_log_t<level_type> *pLog)
+{
+  if (pLog == nullptr)
+    return;
+
+  lsFreePtr(&pLog->pTileIndices);
+  lsFreePtr(&pLog->pOriginalValues);
+  lsFreePtr(&pLog->pRecorded);
+  pLog->count = 0;
+}
+
+template <typename level_type>
+inline lsResult level_undo_log_init(level_undo_log_t<level_type> *pLog)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pLog == nullptr, lsR_ArgumentNull);
+
+  level_undo_log_destroy(pLog);
+
+  LS_ERROR_CHECK(lsAlloc(&pLog->pTileIndices, level_type::total));
+  LS_ERROR_CHECK(lsAlloc(&pLog->pOriginalValues, level_type::total));
+  LS_ERROR_CHECK(lsAllocZero(&pLog->pRecorded, (level_type::total + 63) / 64));
+
+epilogue:
+  if (LS_FAILED(result))
+    level_undo_log_destroy(pLog);
+
+  return result;
+}
+
+// Has to be called before the tile is changed.
+template <typename level_type>
+inline void level_undo_log_record(level_undo_log_t<level_type> *pLog, const level_type &lvl, const size_t tileIndex)
+{
+  lsAssert(tileIndex < level_type::total);
+
+  uint64_t &recorded = pLog->pRecorded[tileIndex / 64];
+  const uint64_t bit = 1ULL << (tileIndex % 64);
+
+  if (recorded & bit)
+    return;
+
+  recorded |= bit;
+
+  lsAssert(pLog->count < level_type::total);
+  pLog->pTileIndices[pLog->count] = (uint32_t)tileIndex;
+  pLog->pOriginalValues[pLog->count] = lvl.grid[tileIndex];
+  pLog->count++;
+}
+
+// Restores all recorded tiles to their original value and empties the log.
+template <typename level_type>
+inline void level_undo_log_restore(level_undo_log_t<level_type> *pLog, level_type *pLevel)
+{
+  for (size_t i = 0; i < pLog->count; i++)
+  {
+    const uint32_t tileIndex = pLog->pTileIndices[i];
+
+    pLevel->grid[tileIndex] = pLog->pOriginalValues[i];
+    pLog->pRecorded[tileIndex / 64] = 0; // all recorded tiles are restored, so the whole word can be cleared.
+  }
+
+  pLog->count = 0;
+}
+
+// Also marks the restored tiles in `pGrowth`, if provided.
+inline void level_undo_log_restore(level_undo_log *pLog, level *pLevel, level_plant_growth *pGrowth)
+{
+  if (pGrowth != nullptr)
+    for (size_t i = 0; i < pLog->count; i++)
+      level_plant_growth_markTile(pGrowth, pLog->pTileIndices[i]);
+
+  level_undo_log_restore(pLog, pLevel);
+}
+
+// Empties the log, keeping the changes.
+template <typename level_type>
+inline void level_undo_log_clear(level_undo_log_t<level_type> *pLog)
+{
+  for (size_t i = 0; i < pLog->count; i++)
+    pLog->pRecorded[pLog->pTileIndices[i] / 64] = 0;
+
+  pLog->count = 0;
+}
+
+// Plants spread into neighbouring tiles and grow back after they've been eaten: every `interval` steps, a passable tile without a food type gains it, if at least `neighbourThreshold` of its four neighbours have it and the tile suits the food (protein & sugar on land, vitamin & fat underwater).
+// Rows that didn't change since the last update and have no changed neighbour rows are skipped.
+// Everything that changes a tile between updates has to mark it through `level_plant_growth_markTile` (eating, regrowth and undo logs do so if they're given the growth), otherwise growth next to it may be missed.
+struct level_plant_growth
+{
+  static constexpr uint8_t io_version = 1;
+
+  static constexpr size_t interval = 8;
+  static constexpr uint8_t neighbourThreshold = 2;
+  static constexpr size_t rowMaskCount = (level::height + 63) / 64;
+
+  uint64_t activeRows[rowMaskCount]; // rows that grew in the last update or were marked since, they and their neighbours have to be evaluated again.
+  uint32_t stepsUntilUpdate;
+};
+
+void level_plant_growth_init(level_plant_growth *pGrowth);
+
+inline void level_plant_growth_markTile(level_plant_growth *pGrowth, const size_t tileIndex)
+{
+  lsAssert(tileIndex < level::total);
+
+  const size_t y = tileIndex / level::width;
+  pGrowth->activeRows[y / 64] |= 1ULL << (y % 64);
+}
+
+// Advances the growth by one step, only updates `pLevel` every `level_plant_growth::interval` steps. Returns true if any tile was changed. Changed tiles are recorded in `pUndoLog`, if provided.
+bool level_growPlants(level *pLevel, level_plant_growth *pGrowth, level_undo_log *pUndoLog = nullptr);
+
+// Food that was eaten grows back on the same tile after `delay` steps.
+// Pending tiles are kept in a hierarchical timer wheel (`wheelCount` wheels of `slotCount` slots, every wheel covering `slotCount` times the steps of the one below), so a step only touches the entries that are due (or are moved down a wheel).
+struct level_regrowth
+{
+  static constexpr uint8_t io_version = 1;
+
+  static constexpr size_t slotBits = 6;
+  static constexpr size_t slotCount = 1ULL << slotBits;
+  static constexpr size_t wheelCount = 3;
+  static constexpr uint32_t maxDelay = (uint32_t)(slotCount - 1) << (slotBits * (wheelCount - 1));
+  static constexpr uint32_t defaultDelay = 64;
+
+  static constexpr size_t foodTypeCount = _actorStats_FoodEnd - _actorStats_FoodBegin + 1;
+  static constexpr size_t entryCount = level::total * foodTypeCount; // one entry per tile & food type, `tileIndex * foodTypeCount + foodIndex`.
+  static constexpr uint32_t noEntry = lsMaxValue<uint32_t>();
+
+  uint32_t delay;
+  uint32_t currentStep;
+  size_t pendingCount;
+  uint32_t slots[wheelCount][slotCount]; // first entry of every slot, `noEntry` if empty.
+  uint32_t next[entryCount];
+  uint32_t due[entryCount];
+  uint8_t pendingFood[level::total]; // the food flags that are scheduled for every tile.
+};
+
+void level_regrowth_init(level_regrowth *pRegrowth, const uint32_t delay = level_regrowth::defaultDelay);
+
+// Schedules `food` to grow back on `tileIndex` in `delay` steps. Does nothing if it's already scheduled.
+void level_regrowth_schedule(level_regrowth *pRegrowth, const size_t tileIndex, const tileFlag food);
+
+// Advances by one step and sets the food of all entries that are due. Returns the number of regrown entries. Changed tiles are recorded in `pUndoLog` and marked in `pGrowth`, if provided.
+size_t level_regrowth_advance(level_regrowth *pRegrowth, level *pLevel, level_undo_log *pUndoLog = nullptr, level_plant_growth *pGrowth = nullptr);
+
+// Schedules an entry that is due at the absolute step `dueStep`, used when reading pending entries.
+void level_regrowth_scheduleAt_internal(level_regrowth *pRegrowth, const size_t tileIndex, const size_t foodIndex, const uint32_t dueStep);
+
+template <byte_stream_writer writer>
+inline lsResult level_regrowth_write(const level_regrowth &regrowth, value_writer<writer> &vw)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(value_writer_write(vw, regrowth.io_version));
+  LS_ERROR_CHECK(value_writer_write(vw, regrowth.delay));
+  LS_ERROR_CHECK(value_writer_write(vw, regrowth.currentStep));
+  LS_ERROR_CHECK(value_writer_write(vw, (uint64_t)regrowth.pendingCount));
+
+  // The wheels are rebuilt when reading, so only the pending entries are stored (in tile order).
+  for (size_t tileIndex = 0; tileIndex < level::total; tileIndex++)
+  {
+    for (size_t foodIndex = 0; foodIndex < level_regrowth::foodTypeCount; foodIndex++)
+    {
+      if (!(regrowth.pendingFood[tileIndex] & (1 << (foodIndex + _actorStats_FoodBegin))))
+        continue;
+
+      LS_ERROR_CHECK(value_writer_write(vw, (uint32_t)(tileIndex * level_regrowth::foodTypeCount + foodIndex)));
+      LS_ERROR_CHECK(value_writer_write(vw, regrowth.due[tileIndex * level_regrowth::foodTypeCount + foodIndex]));
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+template <byte_stream_reader reader>
+inline lsResult level_regrowth_read(level_regrowth &regrowth, value_reader<reader> &vr)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t version;
+  LS_ERROR_CHECK(value_reader_read(vr, version));
+  LS_ERROR_IF(version != regrowth.io_version, lsR_IOFailure);
+
+  uint32_t delay;
+  LS_ERROR_CHECK(value_reader_read(vr, delay));
+  LS_ERROR_IF(delay == 0 || delay > level_regrowth::maxDelay, lsR_IOFailure);
+  level_regrowth_init(&regrowth, delay);
+
+  LS_ERROR_CHECK(value_reader_read(vr, regrowth.currentStep));
+
+  uint64_t pendingCount;
+  LS_ERROR_CHECK(value_reader_read(vr, pendingCount));
+  LS_ERROR_IF(pendingCount > level_regrowth::entryCount, lsR_IOFailure);
+
+  for (uint64_t i = 0; i < pendingCount; i++)
+  {
+    uint32_t entry, dueStep;
+    LS_ERROR_CHECK(value_reader_read(vr, entry));
+    LS_ERROR_CHECK(value_reader_read(vr, dueStep));
+
+    LS_ERROR_IF(entry >= level_regrowth::entryCount, lsR_IOFailure);
+    LS_ERROR_IF(dueStep - regrowth.currentStep - 1 >= delay, lsR_IOFailure); // must be due within `delay` steps.
+    LS_ERROR_IF(regrowth.pendingFood[entry / level_regrowth::foodTypeCount] & (1 << (entry % level_regrowth::foodTypeCount + _actorStats_FoodBegin)), lsR_IOFailure);
+
+    level_regrowth_scheduleAt_internal(&regrowth, entry / level_regrowth::foodTypeCount, entry % level_regrowth::foodTypeCount, dueStep);
+  }
+
+epilogue:
+  return result;
+}
+
+static constexpr uint8_t level_io_version = 1;
+
+template <byte_stream_writer writer, size_t width, size_t height>
+inline lsResult level_write(const level_t<width, height> &lvl, value_writer<writer> &vw)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(value_writer_write(vw, level_io_version));
+  LS_ERROR_CHECK(value_writer_write(vw, (uint64_t)width));
+  LS_ERROR_CHECK(value_writer_write(vw, (uint64_t)height));
+  LS_ERROR_CHECK(value_writer_write(vw, lvl.grid, LS_ARRAYSIZE(lvl.grid)));
+
+epilogue:
+  return result;
+}
+
+template <byte_stream_reader reader, size_t width, size_t height>
+inline lsResult level_read(level_t<width, height> &lvl, value_reader<reader> &vr)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t version;
+  LS_ERROR_CHECK(value_reader_read(vr, version));
+  LS_ERROR_IF(version != level_io_version, lsR_IOFailure);
+
+  uint64_t readWidth, readHeight;
+  LS_ERROR_CHECK(value_reader_read(vr, readWidth));
+  LS_ERROR_CHECK(value_reader_read(vr, readHeight));
+  LS_ERROR_IF(readWidth != width || readHeight != height, lsR_IOFailure);
+
+  LS_ERROR_CHECK(value_reader_read(vr, lvl.grid, LS_ARRAYSIZE(lvl.grid)));
+
+epilogue:
+  return result;
+}
+
+template <byte_stream_writer writer>
+inline lsResult level_plant_growth_write(const level_plant_growth &growth, value_writer<writer> &vw)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(value_writer_write(vw, growth.io_version));
+  LS_ERROR_CHECK(value_writer_write(vw, growth.stepsUntilUpdate));
+  LS_ERROR_CHECK(value_writer_write(vw, growth.activeRows, LS_ARRAYSIZE(growth.activeRows)));
+
+epilogue:
+  return result;
+}
+
+template <byte_stream_reader reader>
+inline lsResult level_plant_growth_read(level_plant_growth &growth, value_reader<reader> &vr)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t version;
+  LS_ERROR_CHECK(value_reader_read(vr, version));
+  LS_ERROR_IF(version != growth.io_version, lsR_IOFailure);
+
+  LS_ERROR_CHECK(value_reader_read(vr, growth.stepsUntilUpdate));
+  LS_ERROR_IF(growth.stepsUntilUpdate == 0 || growth.stepsUntilUpdate > level_plant_growth::interval, lsR_IOFailure);
+  LS_ERROR_CHECK(value_reader_read(vr, growth.activeRows, LS_ARRAYSIZE(growth.activeRows)));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// One bit per tile of a level (bit `i % 64` of `words[i / 64]` is tile `i`), so whole-level queries are a couple of AND / OR / popcount operations.
+struct level_bitplane
+{
+  static constexpr size_t word_count = level::total / 64;
+
+  LS_ALIGN(32) uint64_t words[word_count];
+};
+
+static_assert(level::total % (sizeof(__m256i) * 8) == 0);
+
+// One `level_bitplane` per `tileFlag_` bit. Not kept in sync with `level::grid`: rebuild it whenever the level should be queried.
+struct level_bitplanes
+{
+  level_bitplane planes[8];
+};
+
+void level_bitplanes_build(level_bitplanes *pPlanes, const level &lvl);
+
+inline const level_bitplane &level_bitplanes_get(const level_bitplanes &planes, const tileFlag flag)
+{
+  lsAssert(flag != 0 && (flag & (flag - 1)) == 0); // exactly one flag.
+  return planes.planes[lsLowestBit((uint32_t)flag)];
+}
+
+// All tiles that have any of the flags in `flags`.
+void level_bitplanes_any(const level_bitplanes &planes, const tileFlag flags, level_bitplane *pOut);
+
+void level_bitplane_and(const level_bitplane &a, const level_bitplane &b, level_bitplane *pOut);
+void level_bitplane_or(const level_bitplane &a, const level_bitplane &b, level_bitplane *pOut);
+void level_bitplane_andNot(const level_bitplane &a, const level_bitplane &notB, level_bitplane *pOut);
+
+// All tiles that have a direct (4-connected) neighbour in `plane`.
+void level_bitplane_neighbours(const level_bitplane &plane, level_bitplane *pOut);
+
+size_t level_bitplane_count(const level_bitplane &plane);
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -87,33 +571,219 @@ enum viewConePosition
   _viewConePosition_Count,
 };
 
-struct viewCone
+// A cell of a view cone, relative to the actor: `forward` tiles in look direction, `lateral` tiles to the right of it (negative: to the left).
+struct viewCone_cell
+{
+  int8_t forward, lateral;
+};
+
+// The default cone, in `viewConePosition` order.
+struct viewCone_shape_default
+{
+  static constexpr size_t count = _viewConePosition_Count;
+
+  static constexpr viewCone_cell cell(const size_t index)
+  {
+    constexpr viewCone_cell cells[count] = { { 0, 0 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 2, -1 }, { 2, 0 }, { 2, 1 }, { 3, 0 } };
+    return cells[index];
+  }
+};
+
+// The actor itself, then `radius` rows that widen by one tile to each side every other row, left to right.
+template <size_t radius>
+struct viewCone_shape_wedge
 {
-  uint8_t values[_viewConePosition_Count];
+  static constexpr int8_t halfWidth(const size_t forward) { return (int8_t)((forward + 1) / 2); }
 
-  uint8_t operator [](const viewConePosition pos) const
+  static constexpr size_t countRows(const size_t rows)
+  {
+    size_t ret = 1;
+
+    for (size_t f = 1; f <= rows; f++)
+      ret += halfWidth(f) * 2 + 1;
+
+    return ret;
+  }
+
+  static constexpr size_t count = countRows(radius);
+
+  static constexpr viewCone_cell cell(const size_t index)
+  {
+    if (index == 0)
+      return { 0, 0 };
+
+    size_t f = 1;
+
+    while (index >= countRows(f))
+      f++;
+
+    return { (int8_t)f, (int8_t)((int64_t)(index - countRows(f - 1)) - halfWidth(f)) };
+  }
+};
+
+// Tile offsets (for levels that are `levelWidth` wide) and occlusion masks of a view cone shape, generated at compile time.
+template <typename shape, size_t levelWidth = level::width>
+struct viewCone_layout
+{
+  static constexpr size_t count = shape::count;
+  static_assert(count <= 64, "Occluders are stored as 64 bit masks.");
+
+  int32_t tileOffset[_lookDirection_Count][count] = {};
+  uint64_t occluders[count] = {}; // bit `j` is set if a collidable cell `j` hides cell `i`.
+  size_t reach = 0; // the furthest any cell is away from the actor along either axis.
+  bool occludersInShape = true; // every tile on a ray between the actor and a cell has to be part of the cone.
+  size_t selfIndex = count; // the cell the actor is standing on.
+
+  constexpr viewCone_layout()
+  {
+    // left, up, right, down
+    constexpr int32_t forwardX[_lookDirection_Count] = { -1, 0, 1, 0 };
+    constexpr int32_t forwardY[_lookDirection_Count] = { 0, -1, 0, 1 };
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const viewCone_cell c = shape::cell(i);
+
+      if (c.forward == 0 && c.lateral == 0)
+        selfIndex = i;
+
+      reach = lsMax(reach, (size_t)lsMax(c.forward < 0 ? -c.forward : c.forward, c.lateral < 0 ? -c.lateral : c.lateral));
+
+      for (size_t dir = 0; dir < _lookDirection_Count; dir++)
+      {
+        // right of the look direction is the look direction rotated clockwise.
+        const int32_t x = c.forward * forwardX[dir] - c.lateral * forwardY[dir];
+        const int32_t y = c.forward * forwardY[dir] + c.lateral * forwardX[dir];
+
+        tileOffset[dir][i] = y * (int32_t)levelWidth + x;
+      }
+
+      // Cast a ray from the actor to the cell, any tile it crosses (rounded half away from the center line) occludes the cell.
+      for (int32_t f = 1; f < c.forward; f++)
+      {
+        const int32_t numerator = c.lateral * f;
+        const int32_t magnitude = ((numerator < 0 ? -numerator : numerator) * 2 + c.forward) / (c.forward * 2);
+        const int32_t lateral = numerator < 0 ? -magnitude : magnitude;
+
+        bool found = false;
+
+        for (size_t j = 0; j < count; j++)
+        {
+          if (shape::cell(j).forward == f && shape::cell(j).lateral == lateral)
+          {
+            occluders[i] |= 1ULL << j;
+            found = true;
+          }
+        }
+
+        occludersInShape &= found;
+      }
+    }
+  }
+};
+
+template <typename shape, size_t levelWidth = level::width>
+constexpr viewCone_layout<shape, levelWidth> viewCone_layout_of;
+
+template <typename shape>
+struct viewCone_t
+{
+  static constexpr size_t count = shape::count;
+
+  uint8_t values[count];
+
+  uint8_t operator [](const size_t pos) const
   {
     lsAssert(pos < LS_ARRAYSIZE(values));
     return values[pos];
   }
 };
 
+using viewCone = viewCone_t<viewCone_shape_default>;
+
+// Cells outside of the level are reported as collidable. If `pOccupancy` is provided, cells with other actors on them get `tf_OtherActor`.
+template <typename shape, typename level_type>
+viewCone_t<shape> viewCone_get(const level_type &lvl, const vec2u16 pos, const lookDirection dir, const std::type_identity_t<level_occupancy_t<level_type>> *pOccupancy = nullptr)
+{
+  constexpr const viewCone_layout<shape, level_type::width> &layout = viewCone_layout_of<shape, level_type::width>;
+  static_assert(layout.occludersInShape);
+  static_assert(layout.selfIndex < layout.count);
+
+  lsAssert(pos.x < level_type::width && pos.y < level_type::height && dir < _lookDirection_Count);
+
+  viewCone_t<shape> ret;
+  uint64_t collidable = 0;
+
+  const size_t currentIdx = pos.y * level_type::width + pos.x;
+
+  for (size_t i = 0; i < layout.count; i++)
+  {
+    if constexpr (layout.reach > level_type::wallThickness)
+    {
+      const viewCone_cell c = shape::cell(i);
+      const int64_t x = (int64_t)pos.x + (dir == ld_left ? -c.forward : dir == ld_right ? c.forward : dir == ld_up ? c.lateral : -c.lateral);
+      const int64_t y = (int64_t)pos.y + (dir == ld_up ? -c.forward : dir == ld_down ? c.forward : dir == ld_right ? c.lateral : -c.lateral);
+
+      if (x < 0 || y < 0 || x >= (int64_t)level_type::width || y >= (int64_t)level_type::height)
+      {
+        ret.values[i] = tf_Collidable;
+        collidable |= 1ULL << i;
+        continue;
+      }
+    }
+
+    const size_t tileIdx = currentIdx + layout.tileOffset[dir][i];
+
+    ret.values[i] = lvl.grid[tileIdx];
+    collidable |= (uint64_t)!!(ret.values[i] & tf_Collidable) << i;
+
+    if (pOccupancy != nullptr && pOccupancy->count[tileIdx] > (i == layout.selfIndex ? 1 : 0)) // don't count the actor itself.
+      ret.values[i] |= tf_OtherActor;
+  }
+
+  // hidden flags
+  for (size_t i = 0; i < layout.count; i++)
+    if (collidable & layout.occluders[i])
+      ret.values[i] = tf_Hidden;
+
+  return ret;
+}
+
 viewCone viewCone_get(const level &lvl, const actor &actor);
+viewCone viewCone_get(const level &lvl, const vec2u16 pos, const lookDirection dir, const level_occupancy *pOccupancy = nullptr);
+
+// Samples the view cones of `count` actors, 8 at a time with gathers and without branching on the level contents. `pLookDir` contains `lookDirection`s. `pOccupancy` is optional.
+void viewCone_get_many(const level &lvl, const level_occupancy *pOccupancy, const vec2u16 *pPos, const uint8_t *pLookDir, const size_t count, viewCone *pOut);
 void viewCone_print(const viewCone &values, const actor &actor);
 
 //////////////////////////////////////////////////////////////////////////
 
-struct actor
+// Everything an actor needs per step, apart from the brain.
+struct actor_state
 {
   vec2u16 pos;
   lookDirection look_at_dir;
   uint8_t stats[_actorStats_Count];
   uint8_t stomach_remaining_capacity;
-  neural_net<(_viewConePosition_Count * 8 + _actorStats_Count + (neural_net_block_size - 1)) / neural_net_block_size, 2, 1> brain;
+};
+
+struct actor : actor_state
+{
+  neural_net<(viewCone::count * 8 + _actorStats_Count + (neural_net_block_size - 1)) / neural_net_block_size, 2, 1> brain;
+
+  actor() = default; // uninitialized, e.g. for the genes of an `evolution`.
 
-  actor(const vec2u8 pos, const lookDirection dir) : pos(pos), look_at_dir(dir) { lsAssert(pos.x >= level::wallThickness && pos.x < (level::width - level::wallThickness) && pos.y >= level::wallThickness && pos.y < (level::height - level::wallThickness)); }
+  actor(const vec2u8 pos, const lookDirection dir)
+  {
+    lsAssert(pos.x >= level::wallThickness && pos.x < (level::width - level::wallThickness) && pos.y >= level::wallThickness && pos.y < (level::height - level::wallThickness));
+    this->pos = vec2u16(pos);
+    look_at_dir = dir;
+  }
 };
 
+// Random brain and stats (full energy, food within the stomach capacity), leaves the position and look direction as they are.
+void actor_initRandom(actor *pActor);
+
 enum actorAction
 {
   aa_Move,
@@ -125,5 +795,138 @@ enum actorAction
   _actorAction_Count
 };
 
-void actor_updateStats(actor *pActor, const viewCone &cone);
-void actor_act(actor *pActor, level *pLevel, const viewCone &cone, const actorAction action);
+template <typename rules = actor_rules_default>
+void actor_updateStats(actor_state *pActor, const viewCone &cone);
+
+// Instantiated for all `LEVEL_FOR_EACH_SIZE` levels and `ACTOR_RULES_FOR_EACH` rule sets. If `pOccupancy` is provided, other actors block movement.
+template <typename rules = actor_rules_default, typename level_type>
+void actor_move(actor_state *pActor, const level_type &lvl, const std::type_identity_t<level_occupancy_t<level_type>> *pOccupancy = nullptr);
+
+template <typename rules = actor_rules_default, typename level_type>
+void actor_moveTwo(actor_state *pActor, const level_type &lvl, const std::type_identity_t<level_occupancy_t<level_type>> *pOccupancy = nullptr);
+
+// If `pOccupancy` is provided, other actors block movement and the actor's position is kept up to date in it.
+// Instantiated for all `LEVEL_FOR_EACH_SIZE` levels and `ACTOR_RULES_FOR_EACH` rule sets.
+template <typename rules = actor_rules_default, typename level_type>
+void actor_act(actor_state *pActor, level_type *pLevel, const viewCone &cone, const actorAction action, std::type_identity_t<level_occupancy_t<level_type>> *pOccupancy = nullptr, const std::type_identity_t<level_step_options_t<level_type>> *pOptions = nullptr);
+
+//////////////////////////////////////////////////////////////////////////
+
+// Structure-of-Arrays storage for many actors.
+// The state that is touched every step is kept in tightly packed arrays, the brains live in a separate aligned arena, so stepping all actors doesn't stride over cold weight memory.
+struct actor_population
+{
+  static constexpr size_t capacity_granularity = 32; // per-actor arrays are padded to this, so they can always be processed in full `__m256i` blocks.
+
+  size_t count = 0;
+  size_t capacity = 0;
+  size_t aliveCount = 0;
+
+  vec2u16 *pPos = nullptr;
+  uint8_t *pLookDir = nullptr; // `lookDirection`s.
+  uint8_t *pStats[_actorStats_Count] = {}; // `pStats[as_Energy][actorIndex]`.
+  uint8_t *pStomachRemainingCapacity = nullptr;
+  decltype(actor::brain) *pBrains = nullptr;
+  level_occupancy *pOccupancy = nullptr; // tiles of all actors that still have energy left.
+  uint32_t *pAliveBits = nullptr; // one bit per actor that still has energy left, one word per `capacity_granularity` actors, so dead blocks can be skipped as a whole.
+
+  // Per-step scratch memory.
+  viewCone *pCones = nullptr;
+  uint8_t *pActions = nullptr;
+
+  inline actor_population() {};
+  inline actor_population(const actor_population &) = delete;
+  actor_population &operator =(const actor_population &) = delete;
+
+  ~actor_population();
+};
+
+lsResult actor_population_reserve(actor_population *pPopulation, const size_t capacity);
+lsResult actor_population_add(actor_population *pPopulation, const actor &a, _Out_opt_ size_t *pIndex = nullptr);
+void actor_population_clear(actor_population *pPopulation);
+
+inline void actor_population_markDead(actor_population *pPopulation, const size_t index)
+{
+  static_assert(actor_population::capacity_granularity == sizeof(uint32_t) * CHAR_BIT);
+  lsAssert(index < pPopulation->count && !pPopulation->pStats[as_Energy][index]);
+
+  const uint32_t bit = 1U << (index % actor_population::capacity_granularity);
+  uint32_t &word = pPopulation->pAliveBits[index / actor_population::capacity_granularity];
+
+  if (word & bit)
+  {
+    word &= ~bit;
+    pPopulation->aliveCount--;
+  }
+}
+void actor_population_destroy(actor_population *pPopulation);
+
+inline actor_state actor_population_getState(const actor_population &population, const size_t index)
+{
+  lsAssert(index < population.count);
+
+  actor_state ret;
+  ret.pos = population.pPos[index];
+  ret.look_at_dir = (lookDirection)population.pLookDir[index];
+  ret.stomach_remaining_capacity = population.pStomachRemainingCapacity[index];
+
+  for (size_t i = 0; i < _actorStats_Count; i++)
+    ret.stats[i] = population.pStats[i][index];
+
+  return ret;
+}
+
+inline void actor_population_setState(actor_population *pPopulation, const size_t index, const actor_state &state)
+{
+  lsAssert(index < pPopulation->count);
+
+  pPopulation->pPos[index] = state.pos;
+  pPopulation->pLookDir[index] = (uint8_t)state.look_at_dir;
+  pPopulation->pStomachRemainingCapacity[index] = state.stomach_remaining_capacity;
+
+  for (size_t i = 0; i < _actorStats_Count; i++)
+    pPopulation->pStats[i][index] = state.stats[i];
+}
+
+// Resizes the population to `count` actors and replaces all of their states, the brains of added actors are zeroed. The occupancy and the alive bits are rebuilt from the states.
+lsResult actor_population_restoreStates(actor_population *pPopulation, const actor_state *pStates, const size_t count);
+
+// Updates the stats of all actors that still have energy left, 32 actors at a time, with the same results as the single actor variant. Expects one cone per actor in `pCones`.
+template <typename rules = actor_rules_default>
+void actor_updateStats(actor_population *pPopulation, const viewCone *pCones);
+
+// Unlike the `actor *` variant, the step has two phases: first all actors sample their view cone, update their stats and decide what to do (in parallel on `pThreadPool`, if provided), then the actions are applied in actor order.
+// Conflicts are resolved in favour of the lowest actor index, so the result doesn't depend on the number of threads.
+// Only actors in `pAliveBits` are visited. Returns the number of actors that are still alive after the step.
+template <typename rules = actor_rules_default>
+size_t level_performStep(level &lvl, actor_population *pActors, thread_pool *pThreadPool = nullptr, const level_step_options &options = {});
+
+actorAction actor_chooseAction(const decltype(actor::brain) &brain, const viewCone &cone, const uint8_t(&stats)[_actorStats_Count]);
+
+//////////////////////////////////////////////////////////////////////////
+
+// Steps up to `max_lanes` independent (level, actor) pairs in lockstep.
+// Lane `i` is `actors[i]` living in `pLevels[i]`. View cones are gathered, stats are updated and move / turn actions are applied for all lanes at once, only the brains are evaluated per lane.
+struct lockstep_batch
+{
+  static constexpr size_t max_lanes = actor_population::capacity_granularity;
+
+  level *pLevels = nullptr; // `max_lanes` levels, contiguous, so a single gather can address all of them.
+  actor_population actors;
+
+  inline lockstep_batch() {};
+  inline lockstep_batch(const lockstep_batch &) = delete;
+  lockstep_batch &operator =(const lockstep_batch &) = delete;
+
+  ~lockstep_batch();
+};
+
+lsResult lockstep_batch_init(lockstep_batch *pBatch);
+lsResult lockstep_batch_add(lockstep_batch *pBatch, const level &lvl, const actor &a, _Out_opt_ size_t *pLane = nullptr);
+void lockstep_batch_clear(lockstep_batch *pBatch);
+void lockstep_batch_destroy(lockstep_batch *pBatch);
+
+// Equivalent to calling `level_performStep(pLevels[i], &actor_i, 1)` for every lane that is still alive.
+// Returns the number of lanes that are still alive after the step.
+template <typename rules = actor_rules_default>
+size_t lockstep_batch_step(lockstep_batch *pBatch);
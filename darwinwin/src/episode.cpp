@@ -0,0 +1,648 @@
+#include "episode.h"
+#include "testable.h"
+
+REGISTER_TESTABLE_FILE(5);
+
+template <typename rules>
+episode_result episode_run(level *pLevel, actor *pActor, const episode_options &options /* = {} */)
+{
+  episode_result ret;
+
+  const bool detectCycles = options.detectCycles && options.step.pGrowth == nullptr && options.step.pRegrowth == nullptr;
+  episode_cycle_detector detector;
+  uint32_t levelVersion = 0;
+
+  while (ret.steps < options.maxSteps && pActor->stats[as_Energy])
+  {
+    // A single actor can only change the tile it's standing on (by eating).
+    const size_t tileIndex = pActor->pos.y * level::width + pActor->pos.x;
+    const uint8_t tile = pLevel->grid[tileIndex];
+
+    level_performStep<rules>(*pLevel, pActor, 1, options.step);
+    ret.steps++;
+
+    if (!detectCycles)
+      continue;
+
+    if (pLevel->grid[tileIndex] != tile)
+      levelVersion++;
+
+    episode_cycle_detector_push(&detector, *pActor, levelVersion);
+
+    const size_t skippedSteps = episode_cycle_detector_fastForward<rules>(&detector, pActor, options.maxSteps - ret.steps, pLevel, &pActor->brain);
+    ret.steps += skippedSteps;
+    ret.skippedSteps += skippedSteps;
+  }
+
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static uint32_t episode_cycle_detector_hash(const actor_state &state, const uint32_t levelVersion)
+{
+  uint64_t key = (uint64_t)state.pos.x | ((uint64_t)state.pos.y << 16) | ((uint64_t)state.look_at_dir << 32);
+
+  for (size_t i = 0; i < _actorStats_Count; i++)
+    key ^= (uint64_t)(state.stats[i] >> episode_cycle_detector::statQuantizationBits) << (34 + i * (8 - episode_cycle_detector::statQuantizationBits));
+
+  return hash(key) ^ hash(levelVersion);
+}
+
+void episode_cycle_detector_push(episode_cycle_detector *pDetector, const actor_state &state, const uint32_t levelVersion)
+{
+  episode_cycle_detector::entry &e = pDetector->history[pDetector->count % episode_cycle_detector::historyLength];
+  e.hash = episode_cycle_detector_hash(state, levelVersion);
+  e.levelVersion = levelVersion;
+  e.state = state;
+
+  pDetector->count++;
+}
+
+template <typename rules>
+size_t episode_cycle_detector_fastForward(episode_cycle_detector *pDetector, actor_state *pState, const size_t maxSteps, const level *pLevel /* = nullptr */, const decltype(actor::brain) *pBrain /* = nullptr */)
+{
+  constexpr size_t historyLength = episode_cycle_detector::historyLength;
+  constexpr int64_t minValue = episode_cycle_detector_margin<rules>();
+  constexpr int64_t maxValue = lsMaxValue<uint8_t>() - episode_cycle_detector_margin<rules>();
+
+  static_assert(minValue < maxValue, "The rule amounts are too large to ever skip a cycle.");
+
+  if (pDetector->count == 0)
+    return 0;
+
+  const size_t latest = pDetector->count - 1;
+
+  // `stepsAgo` has to be within the history.
+  auto get = [&](const size_t stepsAgo) -> const episode_cycle_detector::entry & { return pDetector->history[(latest - stepsAgo) % historyLength]; };
+
+  for (size_t length = 1; length <= episode_cycle_detector::maxCycleLength && length * 2 + 1 <= pDetector->count; length++)
+  {
+    if (length > maxSteps)
+      break;
+
+    if (get(0).hash != get(length).hash || get(length).hash != get(length * 2).hash || get(0).levelVersion != get(length * 2).levelVersion)
+      continue;
+
+    // Both periods have to visit the same tiles in the same order and change the stats by the same amount in every step.
+    bool stable = true;
+    int64_t minOffset[_actorStats_Count] = {};
+    int64_t maxOffset[_actorStats_Count] = {};
+
+    for (size_t i = 0; i < length && stable; i++)
+    {
+      const actor_state &a = get(i).state;
+      const actor_state &aPrev = get(i + 1).state;
+      const actor_state &b = get(i + length).state;
+      const actor_state &bPrev = get(i + length + 1).state;
+
+      stable = a.pos == b.pos && a.look_at_dir == b.look_at_dir && a.stomach_remaining_capacity == b.stomach_remaining_capacity;
+
+      for (size_t j = 0; j < _actorStats_Count && stable; j++)
+      {
+        stable = (int64_t)a.stats[j] - aPrev.stats[j] == (int64_t)b.stats[j] - bPrev.stats[j];
+
+        const int64_t offset = (int64_t)a.stats[j] - get(length).state.stats[j];
+        minOffset[j] = lsMin(minOffset[j], offset);
+        maxOffset[j] = lsMax(maxOffset[j], offset);
+      }
+    }
+
+    if (!stable)
+      continue;
+
+    // Skip as many whole cycles as possible, without any drifting stat leaving the margin.
+    size_t cycleCount = maxSteps / length;
+
+    for (size_t j = 0; j < _actorStats_Count; j++)
+    {
+      const int64_t value = pState->stats[j];
+      const int64_t delta = value - get(length).state.stats[j];
+
+      if (delta < 0)
+        cycleCount = lsMin(cycleCount, (size_t)lsMax<int64_t>(0, (value + minOffset[j] - minValue) / -delta));
+      else if (delta > 0)
+        cycleCount = lsMin(cycleCount, (size_t)lsMax<int64_t>(0, (maxValue - value - maxOffset[j]) / delta));
+    }
+
+    if (cycleCount == 0)
+      return 0;
+
+    if (pLevel != nullptr && pBrain != nullptr)
+    {
+      // Step `i` of the cycle started at `get(length - i)`, the level hasn't changed since, so the cones are still the same.
+      viewCone cones[episode_cycle_detector::maxCycleLength];
+      actor_state seen[episode_cycle_detector::maxCycleLength];
+      actorAction actions[episode_cycle_detector::maxCycleLength];
+
+      for (size_t i = 0; i < length; i++)
+      {
+        seen[i] = get(length - i).state;
+        cones[i] = viewCone_get(*pLevel, seen[i].pos, seen[i].look_at_dir);
+        actor_updateStats<rules>(&seen[i], cones[i]); // the brain sees the stats after they've been updated.
+        actions[i] = actor_chooseAction(*pBrain, cones[i], seen[i].stats);
+      }
+
+      size_t sameCycles = 0;
+
+      for (bool same = true; same && sameCycles < cycleCount; sameCycles += same)
+      {
+        for (size_t i = 0; i < length && same; i++)
+        {
+          uint8_t stats[_actorStats_Count];
+
+          for (size_t j = 0; j < _actorStats_Count; j++)
+            stats[j] = (uint8_t)((int64_t)seen[i].stats[j] + (int64_t)(sameCycles + 1) * ((int64_t)pState->stats[j] - get(length).state.stats[j]));
+
+          same = actor_chooseAction(*pBrain, cones[i], stats) == actions[i];
+        }
+      }
+
+      cycleCount = sameCycles;
+
+      // Don't evaluate the same cycle again in the next step.
+      if (cycleCount == 0)
+      {
+        episode_cycle_detector_reset(pDetector);
+        return 0;
+      }
+    }
+
+    for (size_t j = 0; j < _actorStats_Count; j++)
+      pState->stats[j] = (uint8_t)((int64_t)pState->stats[j] + (int64_t)cycleCount * ((int64_t)pState->stats[j] - get(length).state.stats[j]));
+
+    episode_cycle_detector_reset(pDetector);
+
+    return cycleCount * length;
+  }
+
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+lsResult episode_runner_addScenario(episode_runner *pRunner, const level *pLevel, const vec2u8 pos, const lookDirection dir)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pRunner == nullptr || pLevel == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(dir >= _lookDirection_Count, lsR_InvalidParameter);
+
+  {
+    episode_scenario scenario;
+    scenario.pLevel = pLevel;
+    scenario.pos = pos;
+    scenario.dir = dir;
+
+    LS_ERROR_CHECK(list_add(&pRunner->scenarios, scenario));
+  }
+
+epilogue:
+  return result;
+}
+
+lsResult episode_runner_addScenarios(episode_runner *pRunner, const level *const *ppLevels, const size_t levelCount, const vec2u8 *pPositions, const size_t positionCount, const lookDirection *pDirections, const size_t directionCount)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pRunner == nullptr || ppLevels == nullptr || pPositions == nullptr || pDirections == nullptr, lsR_ArgumentNull);
+
+  for (size_t i = 0; i < levelCount; i++)
+    for (size_t j = 0; j < positionCount; j++)
+      for (size_t k = 0; k < directionCount; k++)
+        LS_ERROR_CHECK(episode_runner_addScenario(pRunner, ppLevels[i], pPositions[j], pDirections[k]));
+
+epilogue:
+  return result;
+}
+
+// `*ppTemplate` is the level that `pLevel` has been copied from. If the scenario uses the same one, only the tiles that were changed since are restored with `pUndoLog`.
+template <typename rules>
+static void episode_runner_runScenarios_internal(const episode_runner *pRunner, const size_t first, const size_t end, const actor &a, level *pLevel, level_undo_log *pUndoLog, const level **ppTemplate, actor *pActor, size_t *pSteps)
+{
+  episode_options options;
+  options.maxSteps = pRunner->maxSteps;
+  options.detectCycles = pRunner->detectCycles;
+  options.step.pUndoLog = pUndoLog;
+
+  for (size_t i = first; i < end; i++)
+  {
+    const episode_scenario &scenario = pRunner->scenarios[i];
+
+    if (*ppTemplate == scenario.pLevel)
+    {
+      level_undo_log_restore(pUndoLog, pLevel);
+    }
+    else
+    {
+      *pLevel = *scenario.pLevel;
+      *ppTemplate = scenario.pLevel;
+      level_undo_log_clear(pUndoLog);
+    }
+
+    *pActor = a;
+    pActor->pos = vec2u16(scenario.pos);
+    pActor->look_at_dir = scenario.dir;
+
+    pSteps[i] = episode_run<rules>(pLevel, pActor, options).steps;
+  }
+}
+
+template <typename rules>
+static lsResult episode_runner_runBatch_internal(const episode_runner *pRunner, const size_t first, const size_t end, const actor &a, lockstep_batch *pBatch, actor *pActor, size_t *pSteps)
+{
+  lsResult result = lsR_Success;
+
+  lockstep_batch_clear(pBatch);
+
+  for (size_t i = first; i < end; i++)
+  {
+    const episode_scenario &scenario = pRunner->scenarios[i];
+
+    *pActor = a;
+    pActor->pos = vec2u16(scenario.pos);
+    pActor->look_at_dir = scenario.dir;
+
+    LS_ERROR_CHECK(lockstep_batch_add(pBatch, *scenario.pLevel, *pActor));
+    pSteps[i] = 0;
+  }
+
+  {
+    const uint8_t *pEnergy = pBatch->actors.pStats[as_Energy];
+
+    for (size_t step = 0; step < pRunner->maxSteps && pBatch->actors.aliveCount; step++)
+    {
+      for (size_t i = first; i < end; i++)
+        pSteps[i] += !!pEnergy[i - first];
+
+      lockstep_batch_step<rules>(pBatch);
+    }
+  }
+
+epilogue:
+  return result;
+}
+
+template <typename rules>
+lsResult episode_runner_run(const episode_runner *pRunner, const actor &a, _Out_ size_t *pFitness, _Out_opt_ size_t *pStepsPerScenario /* = nullptr */)
+{
+  lsResult result = lsR_Success;
+
+  size_t *pSteps = pStepsPerScenario;
+  size_t *pOwnedSteps = nullptr;
+  level *pLevels = nullptr;
+  level_undo_log *pUndoLogs = nullptr;
+  const level **ppTemplates = nullptr;
+  actor *pActors = nullptr;
+  lockstep_batch *pBatches = nullptr;
+  lsResult *pTaskResults = nullptr;
+  size_t batchCount = 0;
+  size_t undoLogCount = 0;
+  size_t scenarioCount = 0;
+  size_t scenariosPerTask = 0;
+  size_t taskCount = 0;
+  size_t scratchCount = 0;
+  bool parallel = false;
+
+  LS_ERROR_IF(pRunner == nullptr || pFitness == nullptr, lsR_ArgumentNull);
+
+  *pFitness = 0;
+  scenarioCount = pRunner->scenarios.count;
+
+  if (scenarioCount == 0)
+    goto epilogue;
+
+  if (pSteps == nullptr)
+  {
+    LS_ERROR_CHECK(lsAlloc(&pOwnedSteps, scenarioCount));
+    pSteps = pOwnedSteps;
+  }
+
+  // Without lockstep, every task runs a range of scenarios on its own level, so consecutive scenarios of the same level only have to restore the changed tiles. A few ranges per thread keep the threads busy if the episodes differ in length.
+  if (pRunner->lockstep)
+    scenariosPerTask = lockstep_batch::max_lanes;
+  else if (pRunner->pThreadPool != nullptr)
+  {
+    const size_t rangeCount = (thread_pool_thread_count(pRunner->pThreadPool) + 1) * 4;
+    scenariosPerTask = (scenarioCount + rangeCount - 1) / rangeCount;
+  }
+  else
+    scenariosPerTask = scenarioCount;
+
+  taskCount = (scenarioCount + scenariosPerTask - 1) / scenariosPerTask;
+  parallel = pRunner->pThreadPool != nullptr && taskCount > 1;
+  scratchCount = parallel ? taskCount : 1; // every task gets its own level / batch.
+
+  LS_ERROR_CHECK(lsAllocAligned(&pActors, scratchCount));
+  LS_ERROR_CHECK(lsAlloc(&pTaskResults, taskCount));
+
+  if (pRunner->lockstep)
+  {
+    LS_ERROR_CHECK(lsAllocZero(&pBatches, scratchCount));
+
+    for (; batchCount < scratchCount; batchCount++)
+    {
+      new (&pBatches[batchCount]) lockstep_batch();
+      LS_ERROR_CHECK(lockstep_batch_init(&pBatches[batchCount]));
+    }
+  }
+  else
+  {
+    LS_ERROR_CHECK(lsAlloc(&pLevels, scratchCount));
+    LS_ERROR_CHECK(lsAllocZero(&ppTemplates, scratchCount));
+    LS_ERROR_CHECK(lsAllocZero(&pUndoLogs, scratchCount));
+
+    for (; undoLogCount < scratchCount; undoLogCount++)
+    {
+      new (&pUndoLogs[undoLogCount]) level_undo_log();
+      LS_ERROR_CHECK(level_undo_log_init(&pUndoLogs[undoLogCount]));
+    }
+  }
+
+  {
+    const auto &runTask = [pRunner, &a, pLevels, pUndoLogs, ppTemplates, pActors, pBatches, pSteps, pTaskResults, scenarioCount, scenariosPerTask](const size_t task, const size_t scratch)
+      {
+        const size_t first = task * scenariosPerTask;
+        const size_t end = lsMin(first + scenariosPerTask, scenarioCount);
+
+        if (pBatches != nullptr)
+        {
+          pTaskResults[task] = episode_runner_runBatch_internal<rules>(pRunner, first, end, a, &pBatches[scratch], &pActors[scratch], pSteps);
+        }
+        else
+        {
+          episode_runner_runScenarios_internal<rules>(pRunner, first, end, a, &pLevels[scratch], &pUndoLogs[scratch], &ppTemplates[scratch], &pActors[scratch], pSteps);
+          pTaskResults[task] = lsR_Success;
+        }
+      };
+
+    if (parallel)
+    {
+      for (size_t task = 0; task < taskCount; task++)
+        thread_pool_add(pRunner->pThreadPool, [&runTask, task]() { runTask(task, task); });
+
+      thread_pool_await(pRunner->pThreadPool);
+    }
+    else
+    {
+      for (size_t task = 0; task < taskCount; task++)
+        runTask(task, 0);
+    }
+  }
+
+  for (size_t i = 0; i < taskCount; i++)
+    LS_ERROR_CHECK(pTaskResults[i]);
+
+  for (size_t i = 0; i < scenarioCount; i++)
+    *pFitness += pSteps[i];
+
+epilogue:
+  for (size_t i = 0; i < batchCount; i++)
+    lockstep_batch_destroy(&pBatches[i]);
+
+  for (size_t i = 0; i < undoLogCount; i++)
+    level_undo_log_destroy(&pUndoLogs[i]);
+
+  lsFreePtr(&pBatches);
+  lsFreePtr(&pUndoLogs);
+  lsFreePtr(&ppTemplates);
+  lsFreePtr(&pLevels);
+  lsFreeAlignedPtr(&pActors);
+  lsFreePtr(&pTaskResults);
+  lsFreePtr(&pOwnedSteps);
+  return result;
+}
+
+#define EPISODE_RULES_INSTANTIATE(rules) \
+  template episode_result episode_run<rules>(level *, actor *, const episode_options &); \
+  template size_t episode_cycle_detector_fastForward<rules>(episode_cycle_detector *, actor_state *, const size_t, const level *, const decltype(actor::brain) *); \
+  template lsResult episode_runner_run<rules>(const episode_runner *, const actor &, size_t *, size_t *);
+
+ACTOR_RULES_FOR_EACH(EPISODE_RULES_INSTANTIATE)
+
+#undef EPISODE_RULES_INSTANTIATE
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "level_generator.h"
+
+// Only used to check the fast-forward margin, the steps aren't instantiated for it.
+struct episode_rules_expensive_internal : actor_rules_default
+{
+  static constexpr int64_t IdleEnergyCost = 7;
+  static constexpr int64_t UnderwaterAirCost = 11;
+  static constexpr int64_t MovementEnergyCost = 40;
+  static constexpr int64_t CollideEnergyCost = 20;
+};
+
+DEFINE_TESTABLE(episode_cycle_detector_test)
+{
+  lsResult result = lsR_Success;
+
+  level *pLevelA = nullptr;
+  level *pLevelB = nullptr;
+  actor *pActorA = nullptr;
+  actor *pActorB = nullptr;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelA));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevelB));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActorA));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActorB));
+
+  // An actor that always walks ahead ends up running into a wall forever, on land or under water. The fast-forwarded result has to match the simulated one.
+  for (size_t run = 0; run < 32; run++)
+  {
+    level_initLinear(pLevelA);
+
+    for (size_t i = 0; i < level::total; i++)
+      if (!(pLevelA->grid[i] & tf_Collidable))
+        pLevelA->grid[i] = (run & 1) ? tf_Underwater : 0;
+
+    *pLevelB = *pLevelA;
+
+    new (pActorA) actor(level_getRandomFreePosition(*pLevelA), (lookDirection)(run % _lookDirection_Count));
+
+    lsZeroMemory(pActorA->brain.values, LS_ARRAYSIZE(pActorA->brain.values)); // all outputs are equal, so this always picks `aa_Move`.
+    pActorA->stats[as_Air] = (uint8_t)lsGetRand();
+    pActorA->stats[as_Energy] = 255;
+
+    for (size_t i = _actorStats_FoodBegin; i <= _actorStats_FoodEnd; i++)
+      pActorA->stats[i] = (run < 4) ? 200 : (uint8_t)(lsGetRand() % 256);
+
+    *pActorB = *pActorA;
+
+    episode_options options;
+    options.maxSteps = 100000;
+
+    const episode_result simulated = episode_run(pLevelA, pActorA, options);
+
+    options.detectCycles = true;
+    const episode_result skipped = episode_run(pLevelB, pActorB, options);
+
+    TESTABLE_ASSERT_EQUAL(simulated.skippedSteps, 0ULL);
+    TESTABLE_ASSERT_EQUAL(skipped.steps, simulated.steps);
+    TESTABLE_ASSERT_EQUAL(pActorB->pos, pActorA->pos);
+    TESTABLE_ASSERT_EQUAL(memcmp(pActorB->stats, pActorA->stats, sizeof(pActorA->stats)), 0);
+
+    if (run < 4)
+      TESTABLE_ASSERT_TRUE(skipped.skippedSteps > 0);
+  }
+
+  // Random brains see the exact stats and may act differently once they've drifted far enough, so the skipped cycles have to be validated against the brain.
+  {
+    size_t skippedRuns = 0;
+
+    for (size_t run = 0; run < 64; run++)
+    {
+      level_initLinear(pLevelA);
+      *pLevelB = *pLevelA;
+
+      actor_initRandom(pActorA);
+      pActorA->pos = vec2u16(level_getRandomFreePosition(*pLevelA));
+      pActorA->look_at_dir = (lookDirection)(run % _lookDirection_Count);
+      pActorA->stats[as_Energy] = 255;
+      *pActorB = *pActorA;
+
+      episode_options options;
+      options.maxSteps = 20000;
+
+      const episode_result simulated = episode_run(pLevelA, pActorA, options);
+
+      options.detectCycles = true;
+      const episode_result skipped = episode_run(pLevelB, pActorB, options);
+
+      TESTABLE_ASSERT_EQUAL(skipped.steps, simulated.steps);
+      TESTABLE_ASSERT_EQUAL(pActorB->pos, pActorA->pos);
+      TESTABLE_ASSERT_EQUAL(pActorB->look_at_dir, pActorA->look_at_dir);
+      TESTABLE_ASSERT_EQUAL(memcmp(pActorB->stats, pActorA->stats, sizeof(pActorA->stats)), 0);
+
+      skippedRuns += (skipped.skippedSteps > 0);
+    }
+
+    TESTABLE_ASSERT_TRUE(skippedRuns > 0);
+  }
+
+  // No single step may move a stat past the margin, also with more expensive rules.
+  {
+    static_assert(episode_cycle_detector_margin<actor_rules_default>() >= actor_rules_default::MovementEnergyCost + actor_rules_default::CollideEnergyCost + actor_rules_default::IdleEnergyCost);
+    static_assert(episode_cycle_detector_margin<actor_rules_default>() >= actor_rules_default::DoubleMovementEnergyCost);
+    static_assert(episode_cycle_detector_margin<episode_rules_expensive_internal>() >= episode_rules_expensive_internal::MovementEnergyCost + episode_rules_expensive_internal::CollideEnergyCost + episode_rules_expensive_internal::IdleEnergyCost);
+    static_assert(episode_cycle_detector_margin<episode_rules_expensive_internal>() >= episode_rules_expensive_internal::UnderwaterAirCost);
+  }
+
+  // Stats that don't change linearly don't form a cycle.
+  {
+    episode_cycle_detector detector;
+    actor_state state;
+    lsZeroMemory(&state);
+    state.pos = vec2u16(5, 5);
+    state.stats[as_Energy] = 128;
+
+    for (size_t i = 0; i < episode_cycle_detector::historyLength * 2; i++)
+    {
+      state.stats[as_Air] = (uint8_t)(i * (i + 1) / 2);
+      episode_cycle_detector_push(&detector, state, 0);
+      TESTABLE_ASSERT_EQUAL(episode_cycle_detector_fastForward(&detector, &state, 1000), 0ULL);
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevelA);
+  lsFreePtr(&pLevelB);
+  lsFreeAlignedPtr(&pActorA);
+  lsFreeAlignedPtr(&pActorB);
+  return result;
+}
+
+DEFINE_TESTABLE(episode_runner_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t levelCount = 3;
+  constexpr size_t positionCount = 4;
+  constexpr lookDirection directions[] = { ld_left, ld_up, ld_right, ld_down };
+  constexpr size_t scenarioCount = levelCount * positionCount * LS_ARRAYSIZE(directions); // more than one lockstep batch.
+
+  level *pLevels = nullptr;
+  actor *pActor = nullptr;
+  thread_pool *pThreadPool = thread_pool_new(4);
+  size_t expectedSteps[scenarioCount];
+  size_t steps[scenarioCount];
+  const level *ppLevels[levelCount];
+  vec2u8 positions[positionCount];
+  episode_runner runner;
+
+  static_assert(scenarioCount > lockstep_batch::max_lanes);
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevels, levelCount));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActor));
+
+  for (size_t i = 0; i < levelCount; i++)
+  {
+    level_gen_water_food_level(&pLevels[i]);
+    ppLevels[i] = &pLevels[i];
+  }
+
+  // Start positions that are free on every level.
+  for (size_t i = 0; i < positionCount; i++)
+  {
+    bool blocked;
+
+    do
+    {
+      positions[i] = level_getRandomInteriorPosition();
+      blocked = false;
+
+      for (size_t j = 0; j < levelCount; j++)
+        blocked |= !!(pLevels[j].grid[positions[i].y * level::width + positions[i].x] & tf_Collidable);
+    } while (blocked);
+  }
+
+  TESTABLE_ASSERT_SUCCESS(episode_runner_addScenarios(&runner, ppLevels, levelCount, positions, positionCount, directions, LS_ARRAYSIZE(directions)));
+  TESTABLE_ASSERT_EQUAL(runner.scenarios.count, scenarioCount);
+
+  runner.maxSteps = 256;
+
+  for (size_t run = 0; run < 4; run++)
+  {
+    new (pActor) actor(positions[0], ld_up);
+    actor_initRandom(pActor);
+
+    size_t expectedFitness = 0;
+
+    // Every mode has to match running the episodes one after another.
+    for (size_t i = 0; i < scenarioCount; i++)
+    {
+      level lvl = *runner.scenarios[i].pLevel;
+      actor a = *pActor;
+      a.pos = vec2u16(runner.scenarios[i].pos);
+      a.look_at_dir = runner.scenarios[i].dir;
+
+      episode_options options;
+      options.maxSteps = runner.maxSteps;
+
+      expectedSteps[i] = episode_run(&lvl, &a, options).steps;
+      expectedFitness += expectedSteps[i];
+    }
+
+    for (size_t mode = 0; mode < 4; mode++)
+    {
+      runner.lockstep = !!(mode & 1);
+      runner.pThreadPool = (mode & 2) ? pThreadPool : nullptr;
+
+      size_t fitness;
+      TESTABLE_ASSERT_SUCCESS(episode_runner_run(&runner, *pActor, &fitness, steps));
+      TESTABLE_ASSERT_EQUAL(fitness, expectedFitness);
+      TESTABLE_ASSERT_EQUAL(episode_runner_eval(runner, *pActor), expectedFitness);
+
+      for (size_t i = 0; i < scenarioCount; i++)
+        TESTABLE_ASSERT_EQUAL(steps[i], expectedSteps[i]);
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevels);
+  lsFreeAlignedPtr(&pActor);
+  thread_pool_destroy(&pThreadPool);
+  return result;
+}
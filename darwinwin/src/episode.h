@@ -0,0 +1,120 @@
+#pragma once
+
+#include "darwinwin.h"
+#include "small_list.h"
+
+// Runs a single actor on a level until it runs out of energy or `maxSteps` steps have passed.
+struct episode_options
+{
+  size_t maxSteps = 4096;
+  level_step_options step;
+
+  // A fixed brain on a level that doesn't change often ends up in a loop (e.g. turning left forever), whilst its stats drift linearly.
+  // If enabled, such cycles are detected and skipped, by applying the stat changes of one cycle multiple times at once (see `episode_cycle_detector`).
+  // Ignored if `step` changes the level by itself (plant growth or food regrowth).
+  bool detectCycles = false;
+};
+
+struct episode_result
+{
+  size_t steps = 0; // including the skipped ones.
+  size_t skippedSteps = 0;
+};
+
+// Instantiated for all `ACTOR_RULES_FOR_EACH` rule sets.
+template <typename rules = actor_rules_default>
+episode_result episode_run(level *pLevel, actor *pActor, const episode_options &options = {});
+
+//////////////////////////////////////////////////////////////////////////
+
+// The largest amount a stat can change by within a single step under `rules`: the costs of every step plus the largest amount of an action (the energy thresholds of the actions are below that as well).
+// Whilst the stats stay at least this far away from their bounds, no stat is clamped and no action threshold is crossed, so every step of a cycle changes the stats by the same amount.
+template <typename rules>
+constexpr int64_t episode_cycle_detector_margin()
+{
+  constexpr int64_t foodTypeCount = _actorStats_FoodEnd - _actorStats_FoodBegin + 1;
+  constexpr int64_t actionAmount = lsMax(lsMax(lsAbs(rules::MovementEnergyCost), lsAbs(rules::DoubleMovementEnergyCost)) + lsAbs(rules::CollideEnergyCost), lsMax(lsAbs(rules::TurnEnergy), lsMax(lsAbs(rules::EatEnergyCost), lsAbs(rules::FoodAmount))));
+  constexpr int64_t energyAmount = lsAbs(rules::IdleEnergyCost) + lsAbs(rules::NoAirEnergyCost) + foodTypeCount * lsAbs(rules::FoodEnergyAmount) + actionAmount;
+  constexpr int64_t otherAmount = lsMax(lsMax(lsAbs(rules::UnderwaterAirCost), lsAbs(rules::SurfaceAirAmount)), lsAbs(rules::FoodDigestionAmount) + lsAbs(rules::FoodAmount));
+
+  return lsMax(energyAmount, otherAmount);
+}
+
+// Keeps the last `historyLength` states of an actor. A step is identified by a hash of the position, the look direction, the number of changes to the level so far and the quantized stats.
+// A cycle is stable if the last two periods of the same length start at the same position and direction, don't change the level and change every stat by the same amount in every step.
+// Cycles are only skipped whilst the stats stay at least `episode_cycle_detector_margin` away from their bounds.
+struct episode_cycle_detector
+{
+  static constexpr size_t maxCycleLength = 32;
+  static constexpr size_t historyLength = maxCycleLength * 2 + 1;
+  static constexpr size_t statQuantizationBits = 4;
+
+  struct entry
+  {
+    uint32_t hash;
+    uint32_t levelVersion;
+    actor_state state;
+  };
+
+  entry history[historyLength];
+  size_t count = 0; // number of entries since the last reset, the latest one is at `(count - 1) % historyLength`.
+};
+
+inline void episode_cycle_detector_reset(episode_cycle_detector *pDetector)
+{
+  pDetector->count = 0;
+}
+
+void episode_cycle_detector_push(episode_cycle_detector *pDetector, const actor_state &state, const uint32_t levelVersion);
+
+// Returns the number of skipped steps (a multiple of the cycle length, at most `maxSteps`) and applies the stat changes of the skipped cycles to `pState`, or 0 if there's no stable cycle. The history is reset after skipping.
+// The brain sees the exact stats, so with `pLevel` and `pBrain`, it's evaluated for the stats of every step that would be skipped (with the cones of the last cycle) and only the cycles in which it keeps choosing the same actions are skipped.
+// Without them, the brain is assumed to keep choosing the same actions. Instantiated for all `ACTOR_RULES_FOR_EACH` rule sets.
+template <typename rules = actor_rules_default>
+size_t episode_cycle_detector_fastForward(episode_cycle_detector *pDetector, actor_state *pState, const size_t maxSteps, const level *pLevel = nullptr, const decltype(actor::brain) *pBrain = nullptr);
+
+//////////////////////////////////////////////////////////////////////////
+
+struct episode_scenario
+{
+  const level *pLevel; // copied for every episode, has to outlive the runner.
+  vec2u8 pos;
+  lookDirection dir;
+};
+
+// Scores one actor across a set of scenarios, e.g. `[&](const actor &a) { return episode_runner_eval(runner, a); }` as the `evalFunc` of `evolution_generation`.
+// The fitness is the number of steps the actor survived, summed over all scenarios.
+struct episode_runner
+{
+  small_list<episode_scenario> scenarios;
+  size_t maxSteps = 4096;
+  bool detectCycles = false; // see `episode_options::detectCycles`, not used in lockstep.
+
+  // Runs up to `lockstep_batch::max_lanes` scenarios at once per `lockstep_batch`.
+  bool lockstep = false;
+
+  // If set, ranges of scenarios (or lockstep batches) are run in parallel. `thread_pool_await` waits for all tasks, so don't use the same pool for the evaluation itself (like the parallel `evolution_generation`).
+  thread_pool *pThreadPool = nullptr;
+};
+
+lsResult episode_runner_addScenario(episode_runner *pRunner, const level *pLevel, const vec2u8 pos, const lookDirection dir);
+
+// Adds every combination of the levels, start positions and look directions.
+lsResult episode_runner_addScenarios(episode_runner *pRunner, const level *const *ppLevels, const size_t levelCount, const vec2u8 *pPositions, const size_t positionCount, const lookDirection *pDirections, const size_t directionCount);
+
+// The stats and the brain of `a` are used for every scenario, the position and direction are taken from the scenario.
+// `pStepsPerScenario` (if not `nullptr`) has to hold `pRunner->scenarios.count` values. The scenarios are stepped with `rules`, instantiated for all `ACTOR_RULES_FOR_EACH` rule sets.
+template <typename rules = actor_rules_default>
+lsResult episode_runner_run(const episode_runner *pRunner, const actor &a, _Out_ size_t *pFitness, _Out_opt_ size_t *pStepsPerScenario = nullptr);
+
+// An actor that can't be evaluated (e.g. because an allocation failed) doesn't score.
+template <typename rules = actor_rules_default>
+inline size_t episode_runner_eval(const episode_runner &runner, const actor &a)
+{
+  size_t fitness = 0;
+
+  if (LS_FAILED(episode_runner_run<rules>(&runner, a, &fitness)))
+    return 0;
+
+  return fitness;
+}
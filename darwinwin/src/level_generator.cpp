@@ -1,172 +1,138 @@
 #include "level_generator.h"
 
-void level_gen_finalize(level *pLvl)
+template <typename level_type>
+void level_gen_finalize(level_type *pLvl)
 {
-  for (size_t i = 0; i < level::width; i++)
+  for (size_t i = 0; i < level_type::width; i++)
   {
     pLvl->grid[i] = tf_Collidable;
-    pLvl->grid[i + level::width] = tf_Collidable;
-    pLvl->grid[i + level::width * 2] = tf_Collidable;
+    pLvl->grid[i + level_type::width] = tf_Collidable;
+    pLvl->grid[i + level_type::width * 2] = tf_Collidable;
 
-    pLvl->grid[i + level::width * level::height - 3 * level::width] = tf_Collidable;
-    pLvl->grid[i + level::width * level::height - 2 * level::width] = tf_Collidable;
-    pLvl->grid[i + level::width * level::height - 1 * level::width] = tf_Collidable;
+    pLvl->grid[i + level_type::width * level_type::height - 3 * level_type::width] = tf_Collidable;
+    pLvl->grid[i + level_type::width * level_type::height - 2 * level_type::width] = tf_Collidable;
+    pLvl->grid[i + level_type::width * level_type::height - 1 * level_type::width] = tf_Collidable;
   }
 
-  for (size_t i = 0; i < level::height; i++)
+  for (size_t i = 0; i < level_type::height; i++)
   {
-    pLvl->grid[i * level::width] = tf_Collidable;
-    pLvl->grid[i * level::width + 1] = tf_Collidable;
-    pLvl->grid[i * level::width + 2] = tf_Collidable;
+    pLvl->grid[i * level_type::width] = tf_Collidable;
+    pLvl->grid[i * level_type::width + 1] = tf_Collidable;
+    pLvl->grid[i * level_type::width + 2] = tf_Collidable;
 
-    pLvl->grid[i * level::width + level::width - 1] = tf_Collidable;
-    pLvl->grid[i * level::width + level::width - 2] = tf_Collidable;
-    pLvl->grid[i * level::width + level::width - 3] = tf_Collidable;
+    pLvl->grid[i * level_type::width + level_type::width - 1] = tf_Collidable;
+    pLvl->grid[i * level_type::width + level_type::width - 2] = tf_Collidable;
+    pLvl->grid[i * level_type::width + level_type::width - 3] = tf_Collidable;
   }
 }
 
-void level_gen_fill(level *pLvl, const tileFlag defaultTile)
+template <typename level_type>
+void level_gen_fill(level_type *pLvl, const tileFlag defaultTile)
 {
-  for (size_t i = 0; i < level::total; i++)
+  for (size_t i = 0; i < level_type::total; i++)
     pLvl->grid[i] = defaultTile;
 }
 
-void level_gen_random_sprinkle_replace(level *pLvl, const tileFlag src, const tileFlag target, const size_t count)
+template <typename level_type>
+void level_gen_random_sprinkle_replace(level_type *pLvl, const tileFlag src, const tileFlag target, const size_t count)
 {
   for (size_t i = 0; i < count; i++)
   {
-    const size_t rand = lsGetRand() % level::total;
+    const size_t rand = lsGetRand() % level_type::total;
 
     if (pLvl->grid[rand] == src)
       pLvl->grid[rand] = target;
   }
 }
 
-void level_gen_random_sprinkle_replace_mask(level *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count)
+template <typename level_type>
+void level_gen_random_sprinkle_replace_mask(level_type *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count)
 {
   for (size_t i = 0; i < count; i++)
   {
-    const size_t rand = lsGetRand() % level::total;
+    const size_t rand = lsGetRand() % level_type::total;
 
     if (pLvl->grid[rand] & srcMask)
       pLvl->grid[rand] = target;
   }
 }
 
-void level_gen_random_sprinkle_replace_inv_mask(level *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count)
+template <typename level_type>
+void level_gen_random_sprinkle_replace_inv_mask(level_type *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count)
 {
   for (size_t i = 0; i < count; i++)
   {
-    const size_t rand = lsGetRand() % level::total;
+    const size_t rand = lsGetRand() % level_type::total;
 
     if (~pLvl->grid[rand] & srcMask)
       pLvl->grid[rand] = target;
   }
 }
 
-void level_gen_random_sprinkle_replace_mask_count(level *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count, const size_t matchCount)
+template <typename level_type>
+void level_gen_random_sprinkle_replace_mask_count(level_type *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count, const size_t matchCount)
 {
   for (size_t i = 0; i < count; i++)
   {
-    const size_t rand = lsGetRand() % level::total;
+    const size_t rand = lsGetRand() % level_type::total;
 
     if (__popcnt64(pLvl->grid[rand] & srcMask) >= matchCount)
       pLvl->grid[rand] = target;
   }
 }
 
-void level_gen_random_sprinkle_replace_inv_mask_count(level *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count, const size_t matchCount)
+template <typename level_type>
+void level_gen_random_sprinkle_replace_inv_mask_count(level_type *pLvl, const tileFlag srcMask, const tileFlag target, const size_t count, const size_t matchCount)
 {
   for (size_t i = 0; i < count; i++)
   {
-    const size_t rand = lsGetRand() % level::total;
+    const size_t rand = lsGetRand() % level_type::total;
 
     if (__popcnt64(~pLvl->grid[rand] & srcMask) >= matchCount)
       pLvl->grid[rand] = target;
   }
 }
 
-void level_gen_set_if_mask_internal(level *pLvl, const uint8_t(&maskBuffer)[level::total], const tileFlag target)
-{
-  static_assert(level::total < 1024 * 64, "Ensure that callers have placed their array on the heap... This is NOT an error per-se, but please make sure this has been considered before changing the level size to be abnormally large.");
-
-  for (size_t i = 0; i < level::total; i++)
-  {
-    const uint8_t mask = maskBuffer[i];
-    pLvl->grid[i] = (~mask & pLvl->grid[i]) | (mask & target);
-  }
-}
+//////////////////////////////////////////////////////////////////////////
 
-void level_gen_or_if_mask_internal(level *pLvl, const uint8_t(&maskBuffer)[level::total], const tileFlag target)
+template <typename level_type>
+void level_gen_set_if_mask_row_internal(level_type *pLvl, const size_t y, const uint8_t(&maskRow)[level_type::width], const tileFlag target)
 {
-  static_assert(level::total < 1024 * 64, "Ensure that callers have placed their array on the heap... This is NOT an error per-se, but please make sure this has been considered before changing the level size to be abnormally large.");
+  uint8_t *pRow = pLvl->grid + y * level_type::width;
 
-  for (size_t i = 0; i < level::total; i++)
+  for (size_t x = level_type::wallThickness; x < level_type::width - level_type::wallThickness; x++)
   {
-    const uint8_t mask = maskBuffer[i];
-    pLvl->grid[i] |= (mask & target);
+    const uint8_t mask = maskRow[x];
+    pRow[x] = (~mask & pRow[x]) | (mask & target);
   }
 }
 
-void level_gen_grow(level *pLvl, const tileFlag grownValue)
+// Sets all tiles where `match(self, anyNeighbourIsGrownValue)` returns true to `grownValue`.
+// A row is only written once the row below it has been evaluated, so every tile sees the neighbours of the previous generation, without a mask buffer the size of the whole level.
+template <typename level_type, typename match_func>
+void level_gen_grow_internal(level_type *pLvl, const tileFlag grownValue, const match_func &match)
 {
-  uint8_t maskBuffer[level::total];
+  uint8_t maskRows[2][level_type::width];
 
-  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
+  for (size_t y = level_type::wallThickness; y < level_type::height - level_type::wallThickness; y++)
   {
-    constexpr size_t xStart = level::wallThickness;
-    const size_t lineIdx = y * level::width + xStart;
-    const uint8_t *pUp = pLvl->grid + lineIdx - level::width;
-    const uint8_t *pDown = pLvl->grid + lineIdx + level::width;
-    const uint8_t *pLeft = pLvl->grid + lineIdx - 1;
-    const uint8_t *pRight = pLvl->grid + lineIdx + 1;
-    uint8_t *pOut = maskBuffer + lineIdx;
-
-    for (size_t x = xStart; x < level::width - level::wallThickness; x++)
-    {
-      const bool up = *pUp == grownValue;
-      const bool down = *pDown == grownValue;
-      const bool left = *pLeft == grownValue;
-      const bool right = *pRight == grownValue;
-      const bool anyMatch = up || down || left || right;
-      const uint8_t matchMask = ((uint8_t)!anyMatch) - 1; // true, false -> 0xFF, 0
-      *pOut = matchMask;
-
-      pUp++;
-      pDown++;
-      pLeft++;
-      pRight++;
-      pOut++;
-    }
-  }
-
-  level_gen_set_if_mask_internal(pLvl, maskBuffer, grownValue);
-}
-
-void level_gen_grow_into_mask(level *pLvl, const tileFlag grownValue, const tileFlag replacableMask)
-{
-  uint8_t maskBuffer[level::total];
-
-  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
-  {
-    constexpr size_t xStart = level::wallThickness;
-    const size_t lineIdx = y * level::width + xStart;
+    constexpr size_t xStart = level_type::wallThickness;
+    const size_t lineIdx = y * level_type::width + xStart;
     const uint8_t *pSelf = pLvl->grid + lineIdx;
-    const uint8_t *pUp = pSelf - level::width;
-    const uint8_t *pDown = pSelf + level::width;
+    const uint8_t *pUp = pSelf - level_type::width;
+    const uint8_t *pDown = pSelf + level_type::width;
     const uint8_t *pLeft = pSelf - 1;
     const uint8_t *pRight = pSelf + 1;
-    uint8_t *pOut = maskBuffer + lineIdx;
+    uint8_t *pOut = maskRows[y & 1] + xStart;
 
-    for (size_t x = xStart; x < level::width - level::wallThickness; x++)
+    for (size_t x = xStart; x < level_type::width - level_type::wallThickness; x++)
     {
       const bool up = *pUp == grownValue;
       const bool down = *pDown == grownValue;
       const bool left = *pLeft == grownValue;
       const bool right = *pRight == grownValue;
-      const bool self = !!(*pSelf & replacableMask);
-      const bool match = self && (up || down || left || right);
-      const uint8_t matchMask = ((uint8_t)!match) - 1; // true, false -> 0xFF, 0
+      const bool anyMatch = match(*pSelf, up || down || left || right);
+      const uint8_t matchMask = ((uint8_t)!anyMatch) - 1; // true, false -> 0xFF, 0
       *pOut = matchMask;
 
       pSelf++;
@@ -176,157 +142,68 @@ void level_gen_grow_into_mask(level *pLvl, const tileFlag grownValue, const tile
       pRight++;
       pOut++;
     }
+
+    if (y > level_type::wallThickness)
+      level_gen_set_if_mask_row_internal(pLvl, y - 1, maskRows[(y - 1) & 1], grownValue);
   }
 
-  level_gen_set_if_mask_internal(pLvl, maskBuffer, grownValue);
+  constexpr size_t lastRow = level_type::height - level_type::wallThickness - 1;
+  level_gen_set_if_mask_row_internal(pLvl, lastRow, maskRows[lastRow & 1], grownValue);
 }
 
-void level_gen_grow_into_inv_mask(level *pLvl, const tileFlag grownValue, const tileFlag replacableInvMask)
+template <typename level_type>
+void level_gen_grow(level_type *pLvl, const tileFlag grownValue)
 {
-  uint8_t maskBuffer[level::total];
-
-  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
-  {
-    constexpr size_t xStart = level::wallThickness;
-    const size_t lineIdx = y * level::width + xStart;
-    const uint8_t *pSelf = pLvl->grid + lineIdx;
-    const uint8_t *pUp = pSelf - level::width;
-    const uint8_t *pDown = pSelf + level::width;
-    const uint8_t *pLeft = pSelf - 1;
-    const uint8_t *pRight = pSelf + 1;
-    uint8_t *pOut = maskBuffer + lineIdx;
-
-    for (size_t x = xStart; x < level::width - level::wallThickness; x++)
-    {
-      const bool up = *pUp == grownValue;
-      const bool down = *pDown == grownValue;
-      const bool left = *pLeft == grownValue;
-      const bool right = *pRight == grownValue;
-      const bool self = !!(~*pSelf & replacableInvMask);
-      const bool match = self && (up || down || left || right);
-      const uint8_t matchMask = ((uint8_t)!match) - 1; // true, false -> 0xFF, 0
-      *pOut = matchMask;
-
-      pSelf++;
-      pUp++;
-      pDown++;
-      pLeft++;
-      pRight++;
-      pOut++;
-    }
-  }
-
-  level_gen_set_if_mask_internal(pLvl, maskBuffer, grownValue);
+  level_gen_grow_internal(pLvl, grownValue, [](const uint8_t, const bool anyNeighbour) { return anyNeighbour; });
 }
 
-void level_gen_sprinkle_grow(level *pLvl, const tileFlag grownValue, const uint8_t chance)
+template <typename level_type>
+void level_gen_grow_into_mask(level_type *pLvl, const tileFlag grownValue, const tileFlag replacableMask)
 {
-  uint8_t maskBuffer[level::total];
-
-  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
-  {
-    constexpr size_t xStart = level::wallThickness;
-    const size_t lineIdx = y * level::width + xStart;
-    const uint8_t *pUp = pLvl->grid + lineIdx - level::width;
-    const uint8_t *pDown = pLvl->grid + lineIdx + level::width;
-    const uint8_t *pLeft = pLvl->grid + lineIdx - 1;
-    const uint8_t *pRight = pLvl->grid + lineIdx + 1;
-    uint8_t *pOut = maskBuffer + lineIdx;
-
-    for (size_t x = xStart; x < level::width - level::wallThickness; x++)
-    {
-      const bool up = *pUp == grownValue;
-      const bool down = *pDown == grownValue;
-      const bool left = *pLeft == grownValue;
-      const bool right = *pRight == grownValue;
-      const bool anyMatch = (up || down || left || right) && ((uint8_t)lsGetRand() <= chance);
-      const uint8_t matchMask = ((uint8_t)!anyMatch) - 1; // true, false -> 0xFF, 0
-      *pOut = matchMask;
-
-      pUp++;
-      pDown++;
-      pLeft++;
-      pRight++;
-      pOut++;
-    }
-  }
-
-  level_gen_set_if_mask_internal(pLvl, maskBuffer, grownValue);
+  level_gen_grow_internal(pLvl, grownValue, [=](const uint8_t self, const bool anyNeighbour) { return !!(self & replacableMask) && anyNeighbour; });
 }
 
-void level_gen_sprinkle_grow_into_mask(level *pLvl, const tileFlag grownValue, const tileFlag replacableMask, const uint8_t chance)
+template <typename level_type>
+void level_gen_grow_into_inv_mask(level_type *pLvl, const tileFlag grownValue, const tileFlag replacableInvMask)
 {
-  uint8_t maskBuffer[level::total];
-
-  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
-  {
-    constexpr size_t xStart = level::wallThickness;
-    const size_t lineIdx = y * level::width + xStart;
-    const uint8_t *pSelf = pLvl->grid + lineIdx;
-    const uint8_t *pUp = pSelf - level::width;
-    const uint8_t *pDown = pSelf + level::width;
-    const uint8_t *pLeft = pSelf - 1;
-    const uint8_t *pRight = pSelf + 1;
-    uint8_t *pOut = maskBuffer + lineIdx;
-
-    for (size_t x = xStart; x < level::width - level::wallThickness; x++)
-    {
-      const bool up = *pUp == grownValue;
-      const bool down = *pDown == grownValue;
-      const bool left = *pLeft == grownValue;
-      const bool right = *pRight == grownValue;
-      const bool self = !!(*pSelf & replacableMask);
-      const bool match = self && (up || down || left || right) && ((uint8_t)lsGetRand() <= chance);
-      const uint8_t matchMask = ((uint8_t)!match) - 1; // true, false -> 0xFF, 0
-      *pOut = matchMask;
-
-      pSelf++;
-      pUp++;
-      pDown++;
-      pLeft++;
-      pRight++;
-      pOut++;
-    }
-  }
-
-  level_gen_set_if_mask_internal(pLvl, maskBuffer, grownValue);
-
+  level_gen_grow_internal(pLvl, grownValue, [=](const uint8_t self, const bool anyNeighbour) { return !!(~self & replacableInvMask) && anyNeighbour; });
 }
 
-void level_gen_sprinkle_grow_into_inv_mask(level *pLvl, const tileFlag grownValue, const tileFlag replacableInvMask, const uint8_t chance)
+template <typename level_type>
+void level_gen_sprinkle_grow(level_type *pLvl, const tileFlag grownValue, const uint8_t chance)
 {
-  uint8_t maskBuffer[level::total];
-
-  for (size_t y = level::wallThickness; y < level::height - level::wallThickness; y++)
-  {
-    constexpr size_t xStart = level::wallThickness;
-    const size_t lineIdx = y * level::width + xStart;
-    const uint8_t *pSelf = pLvl->grid + lineIdx;
-    const uint8_t *pUp = pSelf - level::width;
-    const uint8_t *pDown = pSelf + level::width;
-    const uint8_t *pLeft = pSelf - 1;
-    const uint8_t *pRight = pSelf + 1;
-    uint8_t *pOut = maskBuffer + lineIdx;
-
-    for (size_t x = xStart; x < level::width - level::wallThickness; x++)
-    {
-      const bool up = *pUp == grownValue;
-      const bool down = *pDown == grownValue;
-      const bool left = *pLeft == grownValue;
-      const bool right = *pRight == grownValue;
-      const bool self = !!(~*pSelf & replacableInvMask);
-      const bool match = self && (up || down || left || right) && ((uint8_t)lsGetRand() <= chance);
-      const uint8_t matchMask = ((uint8_t)!match) - 1; // true, false -> 0xFF, 0
-      *pOut = matchMask;
+  level_gen_grow_internal(pLvl, grownValue, [=](const uint8_t, const bool anyNeighbour) { return anyNeighbour && ((uint8_t)lsGetRand() <= chance); });
+}
 
-      pSelf++;
-      pUp++;
-      pDown++;
-      pLeft++;
-      pRight++;
-      pOut++;
-    }
-  }
+template <typename level_type>
+void level_gen_sprinkle_grow_into_mask(level_type *pLvl, const tileFlag grownValue, const tileFlag replacableMask, const uint8_t chance)
+{
+  level_gen_grow_internal(pLvl, grownValue, [=](const uint8_t self, const bool anyNeighbour) { return !!(self & replacableMask) && anyNeighbour && ((uint8_t)lsGetRand() <= chance); });
+}
 
-  level_gen_set_if_mask_internal(pLvl, maskBuffer, grownValue);
+template <typename level_type>
+void level_gen_sprinkle_grow_into_inv_mask(level_type *pLvl, const tileFlag grownValue, const tileFlag replacableInvMask, const uint8_t chance)
+{
+  level_gen_grow_internal(pLvl, grownValue, [=](const uint8_t self, const bool anyNeighbour) { return !!(~self & replacableInvMask) && anyNeighbour && ((uint8_t)lsGetRand() <= chance); });
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+#define LEVEL_GEN_INSTANTIATE(level_type) \
+  template void level_gen_finalize<level_type>(level_type *); \
+  template void level_gen_fill<level_type>(level_type *, const tileFlag); \
+  template void level_gen_random_sprinkle_replace<level_type>(level_type *, const tileFlag, const tileFlag, const size_t); \
+  template void level_gen_random_sprinkle_replace_mask<level_type>(level_type *, const tileFlag, const tileFlag, const size_t); \
+  template void level_gen_random_sprinkle_replace_inv_mask<level_type>(level_type *, const tileFlag, const tileFlag, const size_t); \
+  template void level_gen_random_sprinkle_replace_mask_count<level_type>(level_type *, const tileFlag, const tileFlag, const size_t, const size_t); \
+  template void level_gen_random_sprinkle_replace_inv_mask_count<level_type>(level_type *, const tileFlag, const tileFlag, const size_t, const size_t); \
+  template void level_gen_grow<level_type>(level_type *, const tileFlag); \
+  template void level_gen_grow_into_mask<level_type>(level_type *, const tileFlag, const tileFlag); \
+  template void level_gen_grow_into_inv_mask<level_type>(level_type *, const tileFlag, const tileFlag); \
+  template void level_gen_sprinkle_grow<level_type>(level_type *, const tileFlag, const uint8_t); \
+  template void level_gen_sprinkle_grow_into_mask<level_type>(level_type *, const tileFlag, const tileFlag, const uint8_t); \
+  template void level_gen_sprinkle_grow_into_inv_mask<level_type>(level_type *, const tileFlag, const tileFlag, const uint8_t);
+
+LEVEL_FOR_EACH_SIZE(LEVEL_GEN_INSTANTIATE)
+
+#undef LEVEL_GEN_INSTANTIATE
@@ -49,6 +49,8 @@ namespace asio
 
 #include "darwinwin.h"
 #include "testable.h"
+#include "benchmark.h"
+#include "thread_pool.h"
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -70,6 +72,9 @@ static actor _WebActor(vec2u8(level::width / 2, level::height / 2), ld_up);
 static struct {
   bool runTests = true;
   bool runServer = true;
+  bool runBenchmarks = false;
+  testable_options tests;
+  benchmark_options benchmarks;
 } _Args;
 
 //////////////////////////////////////////////////////////////////////////
@@ -87,6 +92,8 @@ int32_t main(const int32_t argc, const char **pArgv)
     return EXIT_FAILURE;
   }
 
+  _Args.tests.threadCount = thread_pool_max_threads();
+
   if (!parse_args(pArgv + 1, argc - 1))
     return EXIT_FAILURE;
 
@@ -125,8 +132,18 @@ int32_t main(const int32_t argc, const char **pArgv)
   if (_Args.runTests)
   {
     print("Running tests...\n");
-    run_testables();
+    run_testables(_Args.tests);
+    print("\n");
+  }
+
+  if (_Args.runBenchmarks)
+  {
+    print("Running benchmarks...\n");
+    const lsResult result = run_benchmarks(_Args.benchmarks);
     print("\n");
+
+    if (LS_FAILED(result) && !_Args.runServer)
+      return EXIT_FAILURE; // so regressions fail CI.
   }
 
   if (_Args.runServer)
@@ -240,6 +257,10 @@ crow::response handle_manualAct(const crow::request &req)
 static const char _ArgNoServer[] = "--no-server";
 static const char _ArgNoTest[] = "--no-test";
 static const char _ArgTestOnly[] = "--test-only";
+static const char _ArgTestFilter[] = "--test";
+static const char _ArgTestSerial[] = "--test-serial";
+static const char _ArgBenchmark[] = "--bench";
+static const char _ArgBenchmarkCompare[] = "--bench-compare";
 
 static bool parse_args(const char **pArgs, const ptrdiff_t count)
 {
@@ -265,6 +286,45 @@ static bool parse_args(const char **pArgs, const ptrdiff_t count)
       argsRemaining--;
       pArgs++;
     }
+    else if (lsStringEquals(_ArgTestFilter, *pArgs) && argsRemaining >= 2)
+    {
+      _Args.runTests = true;
+      _Args.runServer = false;
+      _Args.tests.filter = pArgs[1];
+      argsRemaining -= 2;
+      pArgs += 2;
+    }
+    else if (lsStringEquals(_ArgTestSerial, *pArgs))
+    {
+      _Args.tests.threadCount = 1;
+      argsRemaining--;
+      pArgs++;
+    }
+    else if (lsStringEquals(_ArgBenchmark, *pArgs))
+    {
+      _Args.runBenchmarks = true;
+      _Args.runTests = false;
+      _Args.runServer = false;
+      argsRemaining--;
+      pArgs++;
+
+      // Optional filter.
+      if (argsRemaining > 0 && (*pArgs)[0] != '-')
+      {
+        _Args.benchmarks.filter = *pArgs;
+        argsRemaining--;
+        pArgs++;
+      }
+    }
+    else if (lsStringEquals(_ArgBenchmarkCompare, *pArgs) && argsRemaining >= 2)
+    {
+      _Args.runBenchmarks = true;
+      _Args.runTests = false;
+      _Args.runServer = false;
+      _Args.benchmarks.baselinePath = pArgs[1];
+      argsRemaining -= 2;
+      pArgs += 2;
+    }
     else
     {
       print_error_line("Invalid Parameter '", *pArgs, "'. Aborting.");
@@ -282,4 +342,8 @@ void print_args()
   print("\t", FS(_ArgNoServer, Min(12)), ": Disable running Webserver.\n");
   print("\t", FS(_ArgNoTest, Min(12)), ": Disable running Unit-Tests.\n");
   print("\t", FS(_ArgTestOnly, Min(12)), ": Disable running everything except Unit-Tests (for CI).\n");
+  print("\t", FS(_ArgTestFilter, Min(12)), " <filter>: Only run the Unit-Tests whose name contains 'filter' (implies ", _ArgTestOnly, ").\n");
+  print("\t", FS(_ArgTestSerial, Min(12)), ": Run the Unit-Tests one after another instead of on ", thread_pool_max_threads(), " threads.\n");
+  print("\t", FS(_ArgBenchmark, Min(12)), " [filter]: Only run the Benchmarks (whose name contains 'filter'), the results are written to 'benchmark.json'.\n");
+  print("\t", FS(_ArgBenchmarkCompare, Min(12)), " <baseline.json>: Run the Benchmarks and fail if any median is more than ", FD(Frac(1), AllFrac)(_Args.benchmarks.regressionThreshold * 100.0), " % slower than in 'baseline.json'.\n");
 }
@@ -212,7 +212,8 @@ void evolution_generation(evolution<target, config> &e, func evalFunc, thread_po
     LS_DEBUG_ERROR_ASSERT(pool_add(&e.genes, std::move(uninitialized_baby), &babyIndex));
     LS_DEBUG_ERROR_ASSERT(list_add(&e.bestGeneIndices, babyIndex));
 
-    const auto &eval = [=, &e]()
+    // Captures `evalFunc` by reference, so the task always fits into a slot of the thread pool. It outlives the tasks, as they are awaited below.
+    const auto &eval = [&e, &evalFunc, babyIndex, maxParentIndex]()
       {
         typename evolution<target, config>::gene &baby = *pool_get(e.genes, babyIndex);
 
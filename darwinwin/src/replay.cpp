@@ -0,0 +1,537 @@
+#include "replay.h"
+#include "io.h"
+#include "testable.h"
+
+REGISTER_TESTABLE_FILE(4);
+
+template <byte_stream_writer writer>
+static lsResult actor_state_write(const actor_state &state, value_writer<writer> &vw)
+{
+  lsResult result = lsR_Success;
+
+  // Written member by member, so the padding doesn't end up in the log.
+  LS_ERROR_CHECK(value_writer_write(vw, state.pos.x));
+  LS_ERROR_CHECK(value_writer_write(vw, state.pos.y));
+  LS_ERROR_CHECK(value_writer_write(vw, (uint8_t)state.look_at_dir));
+  LS_ERROR_CHECK(value_writer_write(vw, state.stats, LS_ARRAYSIZE(state.stats)));
+  LS_ERROR_CHECK(value_writer_write(vw, state.stomach_remaining_capacity));
+
+epilogue:
+  return result;
+}
+
+template <byte_stream_reader reader>
+static lsResult actor_state_read(actor_state &state, value_reader<reader> &vr)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t lookDir;
+
+  LS_ERROR_CHECK(value_reader_read(vr, state.pos.x));
+  LS_ERROR_CHECK(value_reader_read(vr, state.pos.y));
+  LS_ERROR_CHECK(value_reader_read(vr, lookDir));
+  LS_ERROR_IF(lookDir >= _lookDirection_Count, lsR_IOFailure);
+  state.look_at_dir = (lookDirection)lookDir;
+  LS_ERROR_CHECK(value_reader_read(vr, state.stats, LS_ARRAYSIZE(state.stats)));
+  LS_ERROR_CHECK(value_reader_read(vr, state.stomach_remaining_capacity));
+
+epilogue:
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+level_replay_writer::~level_replay_writer()
+{
+  level_replay_writer_destroy(this);
+}
+
+template <typename rules>
+lsResult level_replay_writer_init(level_replay_writer *pReplay, const char *filename, const size_t actorCount, const size_t keyframeInterval /* = level_replay_writer::defaultKeyframeInterval */)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pReplay == nullptr || filename == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(keyframeInterval == 0, lsR_InvalidParameter);
+
+  level_replay_writer_destroy(pReplay);
+
+  pReplay->rulesTag = actor_rules_tag<rules>();
+  pReplay->actorCount = actorCount;
+  pReplay->keyframeInterval = keyframeInterval;
+  pReplay->stepCount = 0;
+  pReplay->packedSize = (actorCount * level_replay_writer::action_bits + 7) / 8;
+  pReplay->result = lsR_Success;
+
+  LS_ERROR_CHECK(lsAllocZero(&pReplay->pPackedActions, pReplay->packedSize + 1));
+
+  LS_ERROR_CHECK(write_byte_stream_init(pReplay->stream, filename));
+  LS_ERROR_CHECK(value_writer_init(pReplay->writer, &pReplay->stream));
+
+  LS_ERROR_CHECK(value_writer_write(pReplay->writer, level_replay_writer::io_version));
+  LS_ERROR_CHECK(value_writer_write(pReplay->writer, pReplay->rulesTag));
+  LS_ERROR_CHECK(value_writer_write(pReplay->writer, (uint64_t)actorCount));
+  LS_ERROR_CHECK(value_writer_write(pReplay->writer, (uint64_t)keyframeInterval));
+
+epilogue:
+  if (LS_FAILED(result) && pReplay != nullptr)
+    level_replay_writer_destroy(pReplay);
+
+  return result;
+}
+
+lsResult level_replay_writer_close(level_replay_writer *pReplay)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pReplay == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pReplay->writer.pWriter == nullptr, lsR_ResourceStateInvalid);
+  LS_ERROR_CHECK(pReplay->result);
+
+  for (const uint64_t offset : pReplay->keyframeOffsets)
+    LS_ERROR_CHECK(value_writer_write(pReplay->writer, offset));
+
+  LS_ERROR_CHECK(value_writer_write(pReplay->writer, (uint64_t)pReplay->keyframeOffsets.count));
+  LS_ERROR_CHECK(value_writer_write(pReplay->writer, (uint64_t)pReplay->stepCount));
+  LS_ERROR_CHECK(write_byte_stream_flush(pReplay->stream));
+
+epilogue:
+  if (pReplay != nullptr)
+    level_replay_writer_destroy(pReplay);
+
+  return result;
+}
+
+void level_replay_writer_destroy(level_replay_writer *pReplay)
+{
+  if (pReplay == nullptr)
+    return;
+
+  if (pReplay->writer.pWriter != nullptr)
+  {
+    write_byte_stream_destroy(pReplay->stream);
+    pReplay->writer.pWriter = nullptr;
+  }
+
+  lsFreePtr(&pReplay->pPackedActions);
+  list_destroy(&pReplay->keyframeOffsets);
+}
+
+void level_replay_writer_beginStep(level_replay_writer *pReplay, const level &lvl, const actor_population &actors, const level_step_options &options, const uint64_t rulesTag)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(pReplay->result);
+  LS_ERROR_IF(rulesTag != pReplay->rulesTag, lsR_InvalidParameter);
+  LS_ERROR_IF(actors.count != pReplay->actorCount, lsR_InvalidParameter);
+
+  lsZeroMemory(pReplay->pPackedActions, pReplay->packedSize);
+
+  if (pReplay->stepCount % pReplay->keyframeInterval == 0)
+  {
+    LS_ERROR_CHECK(list_add(&pReplay->keyframeOffsets, (uint64_t)write_byte_stream_pos(pReplay->stream)));
+
+    LS_ERROR_CHECK(level_write(lvl, pReplay->writer));
+
+    for (size_t i = 0; i < actors.count; i++)
+      LS_ERROR_CHECK(actor_state_write(actor_population_getState(actors, i), pReplay->writer));
+
+    LS_ERROR_CHECK(value_writer_write(pReplay->writer, (uint8_t)(options.pGrowth != nullptr)));
+
+    if (options.pGrowth != nullptr)
+      LS_ERROR_CHECK(level_plant_growth_write(*options.pGrowth, pReplay->writer));
+
+    LS_ERROR_CHECK(value_writer_write(pReplay->writer, (uint8_t)(options.pRegrowth != nullptr)));
+
+    if (options.pRegrowth != nullptr)
+      LS_ERROR_CHECK(level_regrowth_write(*options.pRegrowth, pReplay->writer));
+  }
+
+epilogue:
+  pReplay->result = result;
+}
+
+void level_replay_writer_endStep(level_replay_writer *pReplay, const actor_population &actors)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(pReplay->result);
+
+  // Actors that are already dead are stored as `0`, they are skipped when replaying.
+  for (size_t block = 0; block < actors.count; block += actor_population::capacity_granularity)
+  {
+    for (uint32_t alive = actors.pAliveBits[block / actor_population::capacity_granularity]; alive != 0; alive &= alive - 1)
+    {
+      const size_t i = block + lsLowestBit(alive);
+      level_replay_pack_internal(pReplay->pPackedActions, i, actors.pActions[i]);
+    }
+  }
+
+  LS_ERROR_CHECK(value_writer_write(pReplay->writer, pReplay->pPackedActions, pReplay->packedSize));
+  pReplay->stepCount++;
+
+epilogue:
+  pReplay->result = result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+level_replay_reader::~level_replay_reader()
+{
+  level_replay_reader_destroy(this);
+}
+
+template <typename rules>
+lsResult level_replay_reader_init(level_replay_reader *pReplay, const char *filename)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t footerSize = sizeof(uint64_t) * 2;
+
+  uint8_t version;
+  uint64_t rulesTag, actorCount, keyframeInterval, keyframeCount, stepCount;
+
+  LS_ERROR_IF(pReplay == nullptr || filename == nullptr, lsR_ArgumentNull);
+
+  level_replay_reader_destroy(pReplay);
+
+  LS_ERROR_CHECK(read_byte_stream_init(pReplay->stream, filename));
+  LS_ERROR_CHECK(value_reader_init(pReplay->reader, &pReplay->stream));
+
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, version));
+  LS_ERROR_IF(version != level_replay_writer::io_version, lsR_IOFailure);
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, rulesTag));
+  LS_ERROR_IF(rulesTag != actor_rules_tag<rules>(), lsR_InvalidParameter);
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, actorCount));
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, keyframeInterval));
+  LS_ERROR_IF(keyframeInterval == 0, lsR_IOFailure);
+
+  LS_ERROR_IF(read_byte_stream_size(pReplay->stream) < read_byte_stream_pos(pReplay->stream) + footerSize, lsR_IOFailure);
+  LS_ERROR_CHECK(read_byte_stream_seek(pReplay->stream, read_byte_stream_size(pReplay->stream) - footerSize));
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, keyframeCount));
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, stepCount));
+  LS_ERROR_IF(keyframeCount != (stepCount + keyframeInterval - 1) / keyframeInterval, lsR_IOFailure);
+
+  pReplay->rulesTag = rulesTag;
+  pReplay->actorCount = (size_t)actorCount;
+  pReplay->keyframeInterval = (size_t)keyframeInterval;
+  pReplay->stepCount = (size_t)stepCount;
+  pReplay->keyframeCount = (size_t)keyframeCount;
+  pReplay->packedSize = (pReplay->actorCount * level_replay_writer::action_bits + 7) / 8;
+  pReplay->currentStep = (size_t)-1; // nothing has been loaded yet.
+
+  LS_ERROR_CHECK(lsAlloc(&pReplay->pKeyframeOffsets, pReplay->keyframeCount));
+  LS_ERROR_CHECK(lsAllocZero(&pReplay->pPackedActions, pReplay->packedSize + 1));
+  LS_ERROR_CHECK(lsAlloc(&pReplay->pActions, pReplay->actorCount));
+  LS_ERROR_CHECK(lsAlloc(&pReplay->pStates, pReplay->actorCount));
+
+  LS_ERROR_CHECK(read_byte_stream_seek(pReplay->stream, read_byte_stream_size(pReplay->stream) - footerSize - sizeof(uint64_t) * pReplay->keyframeCount));
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, pReplay->pKeyframeOffsets, pReplay->keyframeCount));
+
+epilogue:
+  if (LS_FAILED(result) && pReplay != nullptr)
+    level_replay_reader_destroy(pReplay);
+
+  return result;
+}
+
+void level_replay_reader_destroy(level_replay_reader *pReplay)
+{
+  if (pReplay == nullptr)
+    return;
+
+  if (pReplay->reader.pReader != nullptr)
+  {
+    read_byte_stream_destroy(pReplay->stream);
+    pReplay->reader.pReader = nullptr;
+  }
+
+  lsFreePtr(&pReplay->pKeyframeOffsets);
+  lsFreePtr(&pReplay->pPackedActions);
+  lsFreePtr(&pReplay->pActions);
+  lsFreePtr(&pReplay->pStates);
+}
+
+static lsResult level_replay_loadKeyframe(level_replay_reader *pReplay, const size_t keyframeIndex, level *pLevel, actor_population *pActors, const level_step_options &options)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t hasGrowth, hasRegrowth;
+
+  LS_ERROR_CHECK(read_byte_stream_seek(pReplay->stream, (size_t)pReplay->pKeyframeOffsets[keyframeIndex]));
+
+  LS_ERROR_CHECK(level_read(*pLevel, pReplay->reader));
+
+  for (size_t i = 0; i < pReplay->actorCount; i++)
+    LS_ERROR_CHECK(actor_state_read(pReplay->pStates[i], pReplay->reader));
+
+  LS_ERROR_CHECK(actor_population_restoreStates(pActors, pReplay->pStates, pReplay->actorCount));
+
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, hasGrowth));
+  LS_ERROR_IF(!!hasGrowth != (options.pGrowth != nullptr), lsR_InvalidParameter);
+
+  if (hasGrowth)
+    LS_ERROR_CHECK(level_plant_growth_read(*options.pGrowth, pReplay->reader));
+
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, hasRegrowth));
+  LS_ERROR_IF(!!hasRegrowth != (options.pRegrowth != nullptr), lsR_InvalidParameter);
+
+  if (hasRegrowth)
+    LS_ERROR_CHECK(level_regrowth_read(*options.pRegrowth, pReplay->reader));
+
+  pReplay->currentStep = keyframeIndex * pReplay->keyframeInterval;
+
+epilogue:
+  return result;
+}
+
+template <typename rules>
+lsResult level_replay_seek(level_replay_reader *pReplay, const size_t step, level *pLevel, actor_population *pActors, const level_step_options &options /* = {} */)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pReplay == nullptr || pLevel == nullptr || pActors == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pReplay->rulesTag != actor_rules_tag<rules>(), lsR_InvalidParameter);
+  LS_ERROR_IF(options.pReplay != nullptr || options.pReplayedActions != nullptr, lsR_InvalidParameter);
+  LS_ERROR_IF(step > pReplay->stepCount || pReplay->keyframeCount == 0, lsR_ArgumentOutOfBounds);
+
+  LS_ERROR_CHECK(level_replay_loadKeyframe(pReplay, lsMin(step / pReplay->keyframeInterval, pReplay->keyframeCount - 1), pLevel, pActors, options));
+
+  while (pReplay->currentStep < step)
+    LS_ERROR_CHECK(level_replay_step<rules>(pReplay, pLevel, pActors, options));
+
+epilogue:
+  return result;
+}
+
+template <typename rules>
+lsResult level_replay_step(level_replay_reader *pReplay, level *pLevel, actor_population *pActors, const level_step_options &options /* = {} */)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pReplay == nullptr || pLevel == nullptr || pActors == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(pReplay->rulesTag != actor_rules_tag<rules>(), lsR_InvalidParameter);
+  LS_ERROR_IF(options.pReplay != nullptr || options.pReplayedActions != nullptr, lsR_InvalidParameter);
+  LS_ERROR_IF(pReplay->currentStep >= pReplay->stepCount, lsR_EndOfStream);
+  LS_ERROR_IF(pActors->count != pReplay->actorCount, lsR_ResourceStateInvalid);
+
+  LS_ERROR_CHECK(value_reader_read(pReplay->reader, pReplay->pPackedActions, pReplay->packedSize));
+
+  for (size_t i = 0; i < pReplay->actorCount; i++)
+    pReplay->pActions[i] = level_replay_unpack_internal(pReplay->pPackedActions, i);
+
+  {
+    level_step_options replayOptions = options;
+    replayOptions.pReplayedActions = pReplay->pActions;
+
+    level_performStep<rules>(*pLevel, pActors, nullptr, replayOptions);
+  }
+
+  pReplay->currentStep++;
+
+  // The next step starts with a keyframe, loading it moves the stream past it (the state is the same).
+  if (pReplay->currentStep % pReplay->keyframeInterval == 0 && pReplay->currentStep < pReplay->stepCount)
+    LS_ERROR_CHECK(level_replay_loadKeyframe(pReplay, pReplay->currentStep / pReplay->keyframeInterval, pLevel, pActors, options));
+
+epilogue:
+  return result;
+}
+
+#define REPLAY_RULES_INSTANTIATE(rules) \
+  template lsResult level_replay_writer_init<rules>(level_replay_writer *, const char *, const size_t, const size_t); \
+  template lsResult level_replay_reader_init<rules>(level_replay_reader *, const char *); \
+  template lsResult level_replay_seek<rules>(level_replay_reader *, const size_t, level *, actor_population *, const level_step_options &); \
+  template lsResult level_replay_step<rules>(level_replay_reader *, level *, actor_population *, const level_step_options &);
+
+ACTOR_RULES_FOR_EACH(REPLAY_RULES_INSTANTIATE)
+
+#undef REPLAY_RULES_INSTANTIATE
+
+//////////////////////////////////////////////////////////////////////////
+
+#include "level_generator.h"
+
+DEFINE_TESTABLE(level_replay_pack_test)
+{
+  lsResult result = lsR_Success;
+
+  uint8_t packed[(97 * level_replay_writer::action_bits + 7) / 8 + 1] = {};
+  uint8_t actions[97];
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(actions); i++)
+  {
+    actions[i] = (uint8_t)(lsGetRand() % _actorAction_Count);
+    level_replay_pack_internal(packed, i, actions[i]);
+  }
+
+  for (size_t i = 0; i < LS_ARRAYSIZE(actions); i++)
+    TESTABLE_ASSERT_EQUAL(level_replay_unpack_internal(packed, i), actions[i]);
+
+  TESTABLE_ASSERT_EQUAL(packed[LS_ARRAYSIZE(packed) - 1], (uint8_t)0); // the padding is never written to.
+
+epilogue:
+  return result;
+}
+
+DEFINE_TESTABLE(cached_stream_seek_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t size = 8 * 1024;
+  const char filename[] = "_test/cached_stream_seek_test";
+
+  uint8_t *pData = nullptr;
+  uint8_t *pRead = nullptr;
+  cached_file_byte_stream_reader<> stream;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pData, size));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRead, size));
+
+  for (size_t i = 0; i < size; i++)
+    pData[i] = (uint8_t)(i * 7 + i / 251);
+
+  lsCreateDirectory("_test");
+  TESTABLE_ASSERT_SUCCESS(lsWriteFile(filename, pData, size));
+  TESTABLE_ASSERT_SUCCESS(read_byte_stream_init(stream, filename));
+
+  // A small read fills the buffer, a read larger than the buffer bypasses it.
+  TESTABLE_ASSERT_SUCCESS(read_byte_stream_read(stream, pRead, 10));
+  TESTABLE_ASSERT_SUCCESS(read_byte_stream_read(stream, pRead + 10, 3000));
+  TESTABLE_ASSERT_EQUAL(memcmp(pRead, pData, 3010), 0);
+  TESTABLE_ASSERT_EQUAL(read_byte_stream_pos(stream), (size_t)3010);
+
+  // Seek back into the range that was read directly, then before it and past it.
+  for (const size_t position : { (size_t)2000, (size_t)5, (size_t)3010, (size_t)1500, (size_t)6000, (size_t)100 })
+  {
+    TESTABLE_ASSERT_SUCCESS(read_byte_stream_seek(stream, position));
+    TESTABLE_ASSERT_EQUAL(read_byte_stream_pos(stream), position);
+    TESTABLE_ASSERT_SUCCESS(read_byte_stream_read(stream, pRead, 1500));
+    TESTABLE_ASSERT_EQUAL(memcmp(pRead, pData + position, 1500), 0);
+  }
+
+epilogue:
+  read_byte_stream_destroy(stream);
+  lsFreePtr(&pData);
+  lsFreePtr(&pRead);
+  return result;
+}
+
+// Logs of rule sets that differ in any value can't be mixed up.
+struct actor_rules_scarce_food_internal : actor_rules_default
+{
+  static constexpr int64_t FoodAmount = 1;
+};
+
+static_assert(actor_rules_tag<actor_rules_scarce_food_internal>() != actor_rules_tag<actor_rules_default>());
+
+DEFINE_TESTABLE(level_replay_seek_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t actorCount = 48;
+  constexpr size_t stepCount = 150;
+  constexpr size_t keyframeInterval = 16;
+  const char filename[] = "_test/level_replay_seek_test";
+
+  level *pLevel = nullptr;
+  level *pLevels = nullptr; // the level after every step, `stepCount + 1` levels.
+  actor_state *pStates = nullptr; // the actors after every step.
+  actor *pActor = nullptr;
+  level_regrowth *pRegrowth = nullptr;
+  level_plant_growth *pGrowth = nullptr;
+  thread_pool *pThreadPool = thread_pool_new(4);
+  actor_population population;
+  level_replay_writer writer;
+  level_replay_reader reader;
+
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevel));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pLevels, stepCount + 1));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pStates, (stepCount + 1) * actorCount));
+  TESTABLE_ASSERT_SUCCESS(lsAllocAligned(&pActor));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pRegrowth));
+  TESTABLE_ASSERT_SUCCESS(lsAlloc(&pGrowth));
+
+  // Record an episode.
+  {
+    level_gen_water_food_level(pLevel);
+    level_plant_growth_init(pGrowth);
+    level_regrowth_init(pRegrowth, 5);
+
+    for (size_t i = 0; i < actorCount; i++)
+    {
+      new (pActor) actor(level_getRandomFreePosition(*pLevel), (lookDirection)(lsGetRand() % _lookDirection_Count));
+
+      actor_initRandom(pActor);
+      TESTABLE_ASSERT_SUCCESS(actor_population_add(&population, *pActor));
+    }
+
+    lsCreateDirectory("_test");
+    TESTABLE_ASSERT_SUCCESS(level_replay_writer_init(&writer, filename, actorCount, keyframeInterval));
+
+    level_step_options options;
+    options.pGrowth = pGrowth;
+    options.pRegrowth = pRegrowth;
+    options.pReplay = &writer;
+
+    for (size_t step = 0; step <= stepCount; step++)
+    {
+      pLevels[step] = *pLevel;
+
+      for (size_t i = 0; i < actorCount; i++)
+        pStates[step * actorCount + i] = actor_population_getState(population, i);
+
+      if (step < stepCount)
+        level_performStep(*pLevel, &population, pThreadPool, options);
+    }
+
+    TESTABLE_ASSERT_SUCCESS(level_replay_writer_close(&writer));
+  }
+
+  TESTABLE_ASSERT_SUCCESS(level_replay_reader_init(&reader, filename));
+  TESTABLE_ASSERT_EQUAL(reader.rulesTag, actor_rules_tag<actor_rules_default>());
+  TESTABLE_ASSERT_EQUAL(reader.stepCount, stepCount);
+  TESTABLE_ASSERT_EQUAL(reader.actorCount, actorCount);
+
+  // Seek around without the brains: the population is rebuilt from the keyframes.
+  actor_population_clear(&population);
+
+  for (const size_t step : { (size_t)0, stepCount, keyframeInterval, keyframeInterval - 1, (size_t)37, stepCount - 1, (size_t)5, stepCount / keyframeInterval * keyframeInterval })
+  {
+    level_step_options options;
+    options.pGrowth = pGrowth;
+    options.pRegrowth = pRegrowth;
+
+    TESTABLE_ASSERT_SUCCESS(level_replay_seek(&reader, step, pLevel, &population, options));
+    TESTABLE_ASSERT_EQUAL(reader.currentStep, step);
+
+    // Continue step by step from there (crossing keyframes).
+    for (size_t i = step; i <= lsMin(step + keyframeInterval + 3, stepCount); i++)
+    {
+      if (i > step)
+        TESTABLE_ASSERT_SUCCESS(level_replay_step(&reader, pLevel, &population, options));
+
+      TESTABLE_ASSERT_EQUAL(memcmp(pLevel->grid, pLevels[i].grid, sizeof(pLevel->grid)), 0);
+      TESTABLE_ASSERT_EQUAL(population.count, actorCount);
+
+      for (size_t j = 0; j < actorCount; j++)
+      {
+        const actor_state state = actor_population_getState(population, j);
+        const actor_state &expected = pStates[i * actorCount + j];
+
+        TESTABLE_ASSERT_EQUAL(state.pos, expected.pos);
+        TESTABLE_ASSERT_EQUAL(state.look_at_dir, expected.look_at_dir);
+        TESTABLE_ASSERT_EQUAL(memcmp(state.stats, expected.stats, sizeof(state.stats)), 0);
+      }
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pLevel);
+  lsFreePtr(&pLevels);
+  lsFreePtr(&pStates);
+  lsFreeAlignedPtr(&pActor);
+  lsFreePtr(&pRegrowth);
+  lsFreePtr(&pGrowth);
+  thread_pool_destroy(&pThreadPool);
+  return result;
+}
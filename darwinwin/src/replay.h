@@ -0,0 +1,113 @@
+#pragma once
+
+#include "darwinwin.h"
+#include "stream.h"
+#include "value_io.h"
+#include "small_list.h"
+
+// A compact log of an `actor_population` episode: the action of every actor, `action_bits` bits per actor and step, plus a keyframe of the level, the actors and the growth systems every `keyframeInterval` steps.
+// Any step can be restored by loading the closest keyframe before it and applying the logged actions, without evaluating any brains.
+//
+// The log is only valid for the rule set it was recorded with, the header holds its `actor_rules_tag` and the reader rejects logs of other rule sets.
+//
+// Layout: header (`io_version`, rule set tag, actor count, keyframe interval), then for every step the keyframe (if `step % keyframeInterval == 0`) and the packed actions, then the keyframe offsets, the keyframe count and the step count.
+
+struct level_replay_writer
+{
+  static constexpr uint8_t io_version = 2;
+  static constexpr size_t action_bits = 3;
+  static constexpr size_t defaultKeyframeInterval = 256;
+
+  static_assert(_actorAction_Count <= (1ULL << action_bits));
+
+  cached_file_byte_stream_writer<> stream;
+  value_writer<cached_file_byte_stream_writer<>> writer;
+
+  uint64_t rulesTag = 0;
+  size_t actorCount = 0;
+  size_t keyframeInterval = 0;
+  size_t stepCount = 0;
+  size_t packedSize = 0;
+  uint8_t *pPackedActions = nullptr; // the actions of the current step, with one byte of padding.
+  small_list<uint64_t> keyframeOffsets;
+  lsResult result = lsR_Success; // the first error that occurred whilst stepping, steps can't fail.
+
+  inline level_replay_writer() {};
+  inline level_replay_writer(const level_replay_writer &) = delete;
+  level_replay_writer &operator =(const level_replay_writer &) = delete;
+
+  ~level_replay_writer();
+};
+
+// The episode has to be stepped with the same `rules`, steps with other rules fail the log.
+template <typename rules = actor_rules_default>
+lsResult level_replay_writer_init(level_replay_writer *pReplay, const char *filename, const size_t actorCount, const size_t keyframeInterval = level_replay_writer::defaultKeyframeInterval);
+
+// Writes the keyframe offsets and flushes the log. Returns the first error that occurred whilst stepping, if any.
+lsResult level_replay_writer_close(level_replay_writer *pReplay);
+void level_replay_writer_destroy(level_replay_writer *pReplay);
+
+// Called by `level_performStep`: `beginStep` writes the keyframe (if one is due), `endStep` appends the chosen actions. `rulesTag` is the `actor_rules_tag` of the step.
+void level_replay_writer_beginStep(level_replay_writer *pReplay, const level &lvl, const actor_population &actors, const level_step_options &options, const uint64_t rulesTag);
+void level_replay_writer_endStep(level_replay_writer *pReplay, const actor_population &actors);
+
+//////////////////////////////////////////////////////////////////////////
+
+struct level_replay_reader
+{
+  cached_file_byte_stream_reader<> stream;
+  value_reader<cached_file_byte_stream_reader<>> reader;
+
+  uint64_t rulesTag = 0;
+  size_t actorCount = 0;
+  size_t keyframeInterval = 0;
+  size_t stepCount = 0;
+  size_t packedSize = 0;
+  size_t keyframeCount = 0;
+  uint64_t *pKeyframeOffsets = nullptr;
+  size_t currentStep = 0; // the step that is applied next.
+  uint8_t *pPackedActions = nullptr; // with one byte of padding.
+  uint8_t *pActions = nullptr;
+  actor_state *pStates = nullptr;
+
+  inline level_replay_reader() {};
+  inline level_replay_reader(const level_replay_reader &) = delete;
+  level_replay_reader &operator =(const level_replay_reader &) = delete;
+
+  ~level_replay_reader();
+};
+
+// Fails with `lsR_InvalidParameter` if the log was recorded with other rules.
+template <typename rules = actor_rules_default>
+lsResult level_replay_reader_init(level_replay_reader *pReplay, const char *filename);
+void level_replay_reader_destroy(level_replay_reader *pReplay);
+
+// Restores the state after `step` steps: loads the closest keyframe and applies the logged actions up to `step`.
+// The growth systems in `options` are restored as well, they have to match the ones that were used when recording. `options.pUndoLog` is used as usual.
+template <typename rules = actor_rules_default>
+lsResult level_replay_seek(level_replay_reader *pReplay, const size_t step, level *pLevel, actor_population *pActors, const level_step_options &options = {});
+
+// Applies the logged actions of `pReplay->currentStep`.
+template <typename rules = actor_rules_default>
+lsResult level_replay_step(level_replay_reader *pReplay, level *pLevel, actor_population *pActors, const level_step_options &options = {});
+
+//////////////////////////////////////////////////////////////////////////
+
+inline void level_replay_pack_internal(uint8_t *pPacked, const size_t index, const uint8_t action)
+{
+  const size_t bit = index * level_replay_writer::action_bits;
+
+  pPacked[bit / 8] |= (uint8_t)(action << (bit % 8));
+
+  if (bit % 8 > 8 - level_replay_writer::action_bits)
+    pPacked[bit / 8 + 1] |= (uint8_t)(action >> (8 - bit % 8));
+}
+
+// Expects one byte of padding after the packed actions.
+inline uint8_t level_replay_unpack_internal(const uint8_t *pPacked, const size_t index)
+{
+  const size_t bit = index * level_replay_writer::action_bits;
+  const uint32_t bits = (uint32_t)pPacked[bit / 8] | ((uint32_t)pPacked[bit / 8 + 1] << 8);
+
+  return (uint8_t)((bits >> (bit % 8)) & ((1U << level_replay_writer::action_bits) - 1));
+}
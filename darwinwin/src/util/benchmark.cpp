@@ -0,0 +1,357 @@
+#include "benchmark.h"
+#include "testable.h"
+#include "io.h"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#ifdef _MSC_VER
+const volatile void *_BenchmarkSink = nullptr;
+#endif
+
+static std::map<std::string, benchmark_func> *_pBenchmarks;
+
+_benchmark_init register_benchmark(const char *name, benchmark_func func)
+{
+  static bool initialized = false;
+
+  if (!initialized)
+  {
+    initialized = true;
+    _pBenchmarks = new std::map<std::string, benchmark_func>();
+  }
+
+  _pBenchmarks->insert(std::make_pair(name, func));
+
+  return { _pBenchmarks->size() };
+}
+
+bool benchmark_nextSample_internal(benchmark_state *pState)
+{
+  const int64_t now = lsGetCurrentTimeNs();
+
+  if (pState->iterationsPerSample == 0)
+  {
+    pState->iterationsPerSample = 1;
+    pState->warmupStartNs = now;
+  }
+  else if (pState->calibrating)
+  {
+    const int64_t elapsed = now - pState->sampleStartNs - pState->pausedNs;
+
+    if (elapsed < benchmark_state::minSampleNs)
+    {
+      // Aim a bit above the minimum, but don't grow too quickly after a sample that was too short to be measured properly.
+      const size_t estimate = (size_t)((double_t)pState->iterationsPerSample * benchmark_state::minSampleNs * 1.25 / lsMax((int64_t)1, elapsed));
+      pState->iterationsPerSample = lsClamp(estimate, pState->iterationsPerSample + 1, pState->iterationsPerSample * 16);
+    }
+    else if (now - pState->warmupStartNs >= benchmark_state::warmupNs)
+    {
+      pState->calibrating = false;
+
+      if (pState->pCounters != nullptr)
+        perf_counters_start(pState->pCounters);
+    }
+  }
+  else
+  {
+    pState->pSampleNs[pState->sample] = now - pState->sampleStartNs - pState->pausedNs;
+    pState->sample++;
+
+    if (pState->sample == pState->sampleCount)
+    {
+      if (pState->pCounters != nullptr)
+        perf_counters_stop(pState->pCounters, pState->counterValues, pState->counterValid);
+
+      return false;
+    }
+  }
+
+  pState->iteration = 1;
+  pState->pausedNs = 0;
+  pState->sampleStartNs = lsGetCurrentTimeNs();
+
+  return true;
+}
+
+void benchmark_pauseTiming(benchmark_state *pState)
+{
+  if (!pState->calibrating && pState->pCounters != nullptr)
+    perf_counters_pause(pState->pCounters);
+
+  pState->pauseStartNs = lsGetCurrentTimeNs();
+}
+
+void benchmark_resumeTiming(benchmark_state *pState)
+{
+  pState->pausedNs += lsGetCurrentTimeNs() - pState->pauseStartNs;
+
+  if (!pState->calibrating && pState->pCounters != nullptr)
+    perf_counters_resume(pState->pCounters);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+struct benchmark_result
+{
+  std::string name;
+  size_t iterationsPerSample;
+  double_t minNs;
+  double_t medianNs;
+  double_t p99Ns;
+  double_t meanNs;
+  double_t stdDevNs;
+  double_t itemsPerSecond;
+  bool hasCounters;
+  double_t counterPerOp[_perf_counter_Count]; // negative for counters that aren't valid.
+};
+
+static lsResult benchmark_writeJson(const char *path, const std::vector<benchmark_result> &results)
+{
+  lsResult result = lsR_Success;
+
+  std::string json = "{\n  \"benchmarks\": [\n";
+
+  for (size_t i = 0; i < results.size(); i++)
+  {
+    const benchmark_result &r = results[i];
+
+    json += sformat("    { \"name\": \"", r.name.c_str(), "\", \"iterations_per_sample\": ", r.iterationsPerSample);
+    json += sformat(", \"min_ns\": ", FD(Frac(3), AllFrac)(r.minNs), ", \"median_ns\": ", FD(Frac(3), AllFrac)(r.medianNs), ", \"p99_ns\": ", FD(Frac(3), AllFrac)(r.p99Ns));
+    json += sformat(", \"mean_ns\": ", FD(Frac(3), AllFrac)(r.meanNs), ", \"stddev_ns\": ", FD(Frac(3), AllFrac)(r.stdDevNs), ", \"items_per_second\": ", FD(Frac(0))(r.itemsPerSecond));
+
+    if (r.hasCounters)
+    {
+      for (size_t j = 0; j < _perf_counter_Count; j++)
+        if (r.counterPerOp[j] >= 0)
+          json += sformat(", \"", perf_counter_name((perf_counter)j), "_per_op\": ", FD(Frac(4), AllFrac)(r.counterPerOp[j]));
+
+      if (r.counterPerOp[pc_Cycles] > 0 && r.counterPerOp[pc_Instructions] >= 0)
+        json += sformat(", \"ipc\": ", FD(Frac(3), AllFrac)(r.counterPerOp[pc_Instructions] / r.counterPerOp[pc_Cycles]));
+    }
+
+    json += (i + 1 < results.size()) ? " },\n" : " }\n";
+  }
+
+  json += "  ]\n}\n";
+
+  LS_ERROR_CHECK(lsWriteFile(path, json.c_str(), json.size()));
+
+epilogue:
+  return result;
+}
+
+// Only understands the files written by `benchmark_writeJson`: every result is on its own line.
+static lsResult benchmark_readJson(const char *path, std::map<std::string, double_t> *pMedians)
+{
+  lsResult result = lsR_Success;
+
+  char *pText = nullptr;
+  size_t size = 0;
+
+  LS_ERROR_CHECK(lsReadFile(path, &pText, &size));
+
+  {
+    const std::string text(pText, size);
+    size_t lineStart = 0;
+
+    while (lineStart < text.size())
+    {
+      const size_t lineEnd = lsMin(text.find('\n', lineStart), text.size());
+      const std::string line = text.substr(lineStart, lineEnd - lineStart);
+      lineStart = lineEnd + 1;
+
+      constexpr char nameKey[] = "\"name\": \"";
+      constexpr char medianKey[] = "\"median_ns\": ";
+
+      const size_t nameStart = line.find(nameKey);
+      const size_t medianStart = line.find(medianKey);
+
+      if (nameStart == std::string::npos || medianStart == std::string::npos)
+        continue;
+
+      const size_t nameBegin = nameStart + LS_ARRAYSIZE(nameKey) - 1;
+      const size_t nameEnd = line.find('"', nameBegin);
+      LS_ERROR_IF(nameEnd == std::string::npos, lsR_ResourceInvalid);
+
+      (*pMedians)[line.substr(nameBegin, nameEnd - nameBegin)] = lsParseFloat(line.c_str() + medianStart + LS_ARRAYSIZE(medianKey) - 1);
+    }
+  }
+
+epilogue:
+  lsFreePtr(&pText);
+  return result;
+}
+
+lsResult run_benchmarks(const benchmark_options &options /* = {} */)
+{
+  // Benchmarks are defined in the same files as the tests.
+  register_testable_files<testable_file_count>();
+
+  constexpr size_t sampleCount = 100;
+
+  lsResult result = lsR_Success;
+
+  int64_t sampleNs[sampleCount];
+  double_t nsPerOp[sampleCount];
+  std::vector<benchmark_result> results;
+  std::map<std::string, double_t> baseline;
+  size_t regressions = 0;
+  perf_counters counters;
+  bool hasCounters = false;
+
+  if (_pBenchmarks == nullptr)
+  {
+    print_error_line("No benchmarks discovered.");
+    goto epilogue;
+  }
+
+  if (options.baselinePath != nullptr)
+  {
+    const lsResult r = benchmark_readJson(options.baselinePath, &baseline);
+
+    if (LS_FAILED(r))
+    {
+      print_error_line("Failed to read benchmark baseline '", options.baselinePath, "' (", lsResult_to_string(r), ").");
+      result = r;
+      goto epilogue;
+    }
+  }
+
+  {
+    lsErrorPushSilentImpl _silent;
+    hasCounters = LS_SUCCESS(perf_counters_init(&counters));
+  }
+
+  print(_pBenchmarks->size(), " benchmark(s) discovered.\n");
+
+  if (!hasCounters)
+    print("Hardware performance counters are unavailable.\n");
+
+  print("\n");
+  print(FS("benchmark", Min(40), Max(40)), FS("min ns/op", Min(14)), FS("median", Min(14)), FS("p99", Min(14)), FS("+/-", Min(10)), FS("items/s", Min(16)), (options.baselinePath != nullptr ? "  baseline" : ""), "\n");
+
+  for (const auto &_item : *_pBenchmarks)
+  {
+    if (options.filter != nullptr && _item.first.find(options.filter) == std::string::npos)
+      continue;
+
+    benchmark_state state;
+    state.sampleCount = sampleCount;
+    state.pSampleNs = sampleNs;
+    state.pCounters = hasCounters ? &counters : nullptr;
+
+    lsErrorPushSilentImpl _silent;
+
+    const lsResult r = _item.second(&state);
+
+    if (LS_FAILED(r) || state.sample != sampleCount)
+    {
+      result = lsR_Failure;
+      lsSetConsoleColor(lsCC_BrightRed, lsCC_Black);
+      print(FS(_item.first.c_str(), Min(40), Max(40)), "failed with ", lsResult_to_string(r), "\n");
+      lsResetConsoleColor();
+      continue;
+    }
+
+    double_t mean = 0;
+
+    for (size_t i = 0; i < sampleCount; i++)
+    {
+      nsPerOp[i] = sampleNs[i] / (double_t)state.iterationsPerSample;
+      mean += nsPerOp[i];
+    }
+
+    mean /= (double_t)sampleCount;
+
+    double_t variance = 0;
+
+    for (size_t i = 0; i < sampleCount; i++)
+      variance += (nsPerOp[i] - mean) * (nsPerOp[i] - mean);
+
+    std::sort(nsPerOp, nsPerOp + sampleCount);
+
+    benchmark_result br;
+    br.name = _item.first;
+    br.iterationsPerSample = state.iterationsPerSample;
+    br.minNs = nsPerOp[0];
+    br.medianNs = nsPerOp[sampleCount / 2];
+    br.p99Ns = nsPerOp[(sampleCount * 99 + 99) / 100 - 1];
+    br.meanNs = mean;
+    br.stdDevNs = lsSqrt(variance / (double_t)(sampleCount - 1));
+    br.itemsPerSecond = br.medianNs > 0 ? state.itemsPerIteration * 1e9 / br.medianNs : 0;
+    br.hasCounters = false;
+
+    for (size_t i = 0; i < _perf_counter_Count; i++)
+    {
+      br.counterPerOp[i] = (hasCounters && state.counterValid[i]) ? state.counterValues[i] / (double_t)(sampleCount * state.iterationsPerSample) : -1.0;
+      br.hasCounters |= br.counterPerOp[i] >= 0;
+    }
+
+    print(FS(_item.first.c_str(), Min(40), Max(40)), FD(Min(14), Frac(2), AllFrac)(br.minNs), FD(Min(14), Frac(2), AllFrac)(br.medianNs), FD(Min(14), Frac(2), AllFrac)(br.p99Ns), FD(Min(8), Frac(2), AllFrac)(mean > 0 ? br.stdDevNs / mean * 100.0 : 0), " %", FD(Min(16), Group, Frac(0))(br.itemsPerSecond));
+
+    if (options.baselinePath != nullptr)
+    {
+      const auto &it = baseline.find(_item.first);
+
+      if (it == baseline.end() || it->second <= 0)
+      {
+        print("  (new)");
+      }
+      else
+      {
+        const double_t change = br.medianNs / it->second - 1.0;
+        const bool regressed = change > options.regressionThreshold;
+
+        regressions += regressed;
+        lsSetConsoleColor(regressed ? lsCC_BrightRed : (change < -options.regressionThreshold ? lsCC_BrightGreen : lsCC_DarkGray), lsCC_Black);
+        print("  ", change >= 0 ? "+" : "", FD(Frac(1), AllFrac)(change * 100.0), " %", regressed ? " REGRESSION" : "");
+        lsResetConsoleColor();
+      }
+    }
+
+    print("\n");
+
+    if (br.hasCounters)
+    {
+      lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
+      print("  ");
+
+      if (br.counterPerOp[pc_Cycles] > 0 && br.counterPerOp[pc_Instructions] >= 0)
+        print(" ipc: ", FD(Frac(2), AllFrac)(br.counterPerOp[pc_Instructions] / br.counterPerOp[pc_Cycles]));
+
+      for (size_t i = 0; i < _perf_counter_Count; i++)
+        if (br.counterPerOp[i] >= 0)
+          print(" ", perf_counter_name((perf_counter)i), "/op: ", FD(Frac(3), AllFrac)(br.counterPerOp[i]));
+
+      print("\n");
+      lsResetConsoleColor();
+    }
+
+    results.push_back(std::move(br));
+  }
+
+  if (options.outputPath != nullptr)
+  {
+    const lsResult r = benchmark_writeJson(options.outputPath, results);
+
+    if (LS_FAILED(r))
+    {
+      print_error_line("Failed to write benchmark results to '", options.outputPath, "' (", lsResult_to_string(r), ").");
+      result = r;
+    }
+  }
+
+  if (regressions > 0)
+  {
+    lsSetConsoleColor(lsCC_BrightRed, lsCC_Black);
+    print(regressions, " benchmark(s) regressed by more than ", FD(Frac(1), AllFrac)(options.regressionThreshold * 100.0), " %.\n");
+    lsResetConsoleColor();
+    result = lsR_Failure;
+  }
+
+  goto epilogue;
+epilogue:
+  return result;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "core.h"
+#include "perf_counters.h"
+
+struct _benchmark_init { size_t instanceId; };
+
+// Passed to every benchmark. Everything before the `while (benchmark_keepRunning(pState))` loop is setup and isn't measured.
+// The loop is warmed up first, whilst the number of iterations per sample is calibrated so that every sample takes at least `minSampleNs`. Then `sampleCount` samples are timed on their own.
+// The hardware counters (if available) run for all samples together.
+// Work that has to happen inside the loop but shouldn't be measured (e.g. restoring state) goes between `benchmark_pauseTiming` and `benchmark_resumeTiming`. Pausing costs a few clock reads (and syscalls for the counters), so don't do it every iteration of short benchmarks.
+struct benchmark_state
+{
+  static constexpr int64_t minSampleNs = 500 * 1000;
+  static constexpr int64_t warmupNs = 20 * 1000 * 1000;
+
+  size_t itemsPerIteration = 1; // e.g. the number of actors that are stepped per iteration.
+  size_t sampleCount = 0;
+
+  bool calibrating = true;
+  size_t iterationsPerSample = 0; // 0 until the loop is entered.
+  size_t iteration = 0;
+  size_t sample = 0;
+  int64_t warmupStartNs = 0;
+  int64_t sampleStartNs = 0;
+  int64_t pauseStartNs = 0;
+  int64_t pausedNs = 0; // within the current sample.
+  int64_t *pSampleNs = nullptr; // `sampleCount` values.
+
+  perf_counters *pCounters = nullptr;
+  uint64_t counterValues[_perf_counter_Count] = {};
+  bool counterValid[_perf_counter_Count] = {}; // counters that actually measured something, the others aren't reported.
+};
+
+// Only ever called when a sample is complete.
+bool benchmark_nextSample_internal(benchmark_state *pState);
+
+inline bool benchmark_keepRunning(benchmark_state *pState)
+{
+  if (pState->iteration == pState->iterationsPerSample) _UNLIKELY
+    return benchmark_nextSample_internal(pState);
+
+  pState->iteration++;
+
+  return true;
+}
+
+void benchmark_pauseTiming(benchmark_state *pState);
+void benchmark_resumeTiming(benchmark_state *pState);
+
+// Keeps the compiler from discarding `value` or the computation that produced it.
+template <typename T>
+inline void benchmark_doNotOptimize(const T &value)
+{
+#ifdef _MSC_VER
+  extern const volatile void *_BenchmarkSink;
+  _BenchmarkSink = &value;
+  _ReadWriteBarrier();
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// Keeps the compiler from assuming anything about memory across this point, so pending writes can't be dropped.
+inline void benchmark_clobberMemory()
+{
+#ifdef _MSC_VER
+  _ReadWriteBarrier();
+#else
+  asm volatile("" : : : "memory");
+#endif
+}
+
+typedef lsResult(*benchmark_func)(benchmark_state *pState);
+_benchmark_init register_benchmark(const char *name, benchmark_func func);
+
+struct benchmark_options
+{
+  const char *filter = nullptr; // only the benchmarks whose name contains `filter` are run.
+  const char *outputPath = "benchmark.json"; // the results are written there as JSON (if not `nullptr`).
+  const char *baselinePath = nullptr; // a JSON file written by an earlier run, the medians are compared against it (if not `nullptr`).
+  double_t regressionThreshold = 0.05; // relative increase of the median that counts as a regression.
+};
+
+// Fails if a benchmark failed or regressed.
+lsResult run_benchmarks(const benchmark_options &options = {});
+
+// Benchmarks live next to the tests of the code they measure, the files are registered through `REGISTER_TESTABLE_FILE`.
+#define DEFINE_BENCHMARK(name) \
+  lsResult benchmark_ ## name(benchmark_state *pState); \
+  struct benchmark_ ## name ## obj \
+  { const _benchmark_init &__benchmark_init_; \
+    inline benchmark_ ## name ## obj() : __benchmark_init_(register_benchmark(#name, & benchmark_ ## name)) { } \
+  }; \
+  __pragma(comment(linker, "/include:__benchmark__" #name "__ref")) \
+  extern "C" auto __benchmark__ ## name ## __ref = benchmark_ ## name ## obj(); \
+  lsResult benchmark_ ## name(benchmark_state *pState)
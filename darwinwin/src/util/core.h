@@ -472,6 +472,60 @@ inline void lsFreePtr(_In_Out_ T **ppData)
   }
 }
 
+template <typename T>
+inline lsResult lsAllocAligned(_Out_ T **ppData, const size_t count = 1, const size_t alignment = 32)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(ppData == nullptr, lsR_ArgumentNull);
+  LS_ERROR_IF(alignment == 0 || (alignment & (alignment - 1)) != 0, lsR_InvalidParameter);
+
+  // Allocate Memory.
+  {
+    const size_t size = ((sizeof(T) * count + alignment - 1) / alignment) * alignment;
+#ifdef LS_PLATFORM_WINDOWS
+    T *pData = reinterpret_cast<T *>(_aligned_malloc(size, alignment));
+#else
+    T *pData = reinterpret_cast<T *>(aligned_alloc(alignment, size));
+#endif
+    LS_ERROR_IF(pData == nullptr, lsR_MemoryAllocationFailure);
+    *ppData = pData;
+  }
+
+epilogue:
+  if (LS_FAILED(result) && ppData != nullptr)
+    *ppData = nullptr;
+
+  return result;
+}
+
+template <typename T>
+inline lsResult lsAllocAlignedZero(_Out_ T **ppData, const size_t count = 1, const size_t alignment = 32)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_CHECK(lsAllocAligned(ppData, count, alignment));
+  lsZeroMemory(*ppData, count);
+
+epilogue:
+  return result;
+}
+
+// Only for memory that was allocated through `lsAllocAligned` / `lsAllocAlignedZero`.
+template <typename T>
+inline void lsFreeAlignedPtr(_In_Out_ T **ppData)
+{
+  if (ppData != nullptr && *ppData != nullptr)
+  {
+#ifdef LS_PLATFORM_WINDOWS
+    _aligned_free((void *)(*ppData));
+#else
+    free((void *)(*ppData));
+#endif
+    *ppData = nullptr;
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 constexpr double_t lsPI = M_PI;
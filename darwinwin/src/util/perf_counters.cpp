@@ -0,0 +1,203 @@
+#include "perf_counters.h"
+
+#ifdef LS_PLATFORM_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char *perf_counter_name(const perf_counter counter)
+{
+  switch (counter)
+  {
+  case pc_Cycles: return "cycles";
+  case pc_Instructions: return "instructions";
+  case pc_L1DMisses: return "l1d_misses";
+  case pc_LLCMisses: return "llc_misses";
+  case pc_BranchMisses: return "branch_misses";
+  default: return "<invalid>";
+  }
+}
+
+perf_counters::~perf_counters()
+{
+  perf_counters_destroy(this);
+}
+
+#ifdef LS_PLATFORM_LINUX
+
+static int32_t perf_counters_open_internal(const uint32_t type, const uint64_t config, const int32_t groupFd)
+{
+  perf_event_attr attr;
+  lsZeroMemory(&attr);
+
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = groupFd == -1; // the group is enabled through its leader.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int32_t)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+lsResult perf_counters_init(perf_counters *pCounters)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pCounters == nullptr, lsR_ArgumentNull);
+
+  perf_counters_destroy(pCounters);
+
+  {
+    constexpr struct { uint32_t type; uint64_t config; } events[_perf_counter_Count] =
+    {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+      { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+
+    // The cycles lead the group, so all counters run at the same time. If there are no cycles, every counter runs on its own.
+    int32_t groupFd = -1;
+
+    for (size_t i = 0; i < _perf_counter_Count; i++)
+    {
+      pCounters->fd[i] = perf_counters_open_internal(events[i].type, events[i].config, groupFd);
+
+      // The group may be full, try on its own.
+      if (pCounters->fd[i] < 0 && groupFd != -1)
+        pCounters->fd[i] = perf_counters_open_internal(events[i].type, events[i].config, -1);
+
+      if (pCounters->fd[i] < 0)
+      {
+        pCounters->fd[i] = -1;
+        continue;
+      }
+
+      pCounters->available[i] = true;
+      pCounters->availableCount++;
+
+      if (i == pc_Cycles)
+        groupFd = pCounters->fd[i];
+    }
+  }
+
+  LS_ERROR_IF(pCounters->availableCount == 0, lsR_NotSupported);
+
+epilogue:
+  return result;
+}
+
+void perf_counters_destroy(perf_counters *pCounters)
+{
+  if (pCounters == nullptr)
+    return;
+
+  for (size_t i = 0; i < _perf_counter_Count; i++)
+  {
+    if (pCounters->fd[i] >= 0)
+      close(pCounters->fd[i]);
+
+    pCounters->fd[i] = -1;
+    pCounters->available[i] = false;
+  }
+
+  pCounters->availableCount = 0;
+}
+
+void perf_counters_start(perf_counters *pCounters)
+{
+  for (size_t i = 0; i < _perf_counter_Count; i++)
+    if (pCounters->fd[i] >= 0)
+      ioctl(pCounters->fd[i], PERF_EVENT_IOC_RESET, 0);
+
+  for (size_t i = 0; i < _perf_counter_Count; i++)
+    if (pCounters->fd[i] >= 0)
+      ioctl(pCounters->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void perf_counters_pause(perf_counters *pCounters)
+{
+  for (size_t i = 0; i < _perf_counter_Count; i++)
+    if (pCounters->fd[i] >= 0)
+      ioctl(pCounters->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+}
+
+void perf_counters_resume(perf_counters *pCounters)
+{
+  for (size_t i = 0; i < _perf_counter_Count; i++)
+    if (pCounters->fd[i] >= 0)
+      ioctl(pCounters->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void perf_counters_stop(perf_counters *pCounters, _Out_ uint64_t (&values)[_perf_counter_Count], _Out_ bool (&valid)[_perf_counter_Count])
+{
+  perf_counters_pause(pCounters);
+
+  for (size_t i = 0; i < _perf_counter_Count; i++)
+  {
+    values[i] = 0;
+    valid[i] = false;
+
+    if (pCounters->fd[i] < 0)
+      continue;
+
+    struct { uint64_t value, timeEnabled, timeRunning; } data;
+
+    if (read(pCounters->fd[i], &data, sizeof(data)) != (ssize_t)sizeof(data) || data.timeRunning == 0)
+      continue;
+
+    values[i] = data.timeRunning < data.timeEnabled ? (uint64_t)((double_t)data.value * data.timeEnabled / data.timeRunning) : data.value;
+    valid[i] = true;
+  }
+}
+
+#else
+
+lsResult perf_counters_init(perf_counters *pCounters)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(pCounters == nullptr, lsR_ArgumentNull);
+  LS_ERROR_SET(lsR_NotSupported);
+
+epilogue:
+  return result;
+}
+
+void perf_counters_destroy(perf_counters *pCounters)
+{
+  (void)pCounters;
+}
+
+void perf_counters_start(perf_counters *pCounters)
+{
+  (void)pCounters;
+}
+
+void perf_counters_pause(perf_counters *pCounters)
+{
+  (void)pCounters;
+}
+
+void perf_counters_resume(perf_counters *pCounters)
+{
+  (void)pCounters;
+}
+
+void perf_counters_stop(perf_counters *pCounters, _Out_ uint64_t (&values)[_perf_counter_Count], _Out_ bool (&valid)[_perf_counter_Count])
+{
+  (void)pCounters;
+
+  for (size_t i = 0; i < _perf_counter_Count; i++)
+  {
+    values[i] = 0;
+    valid[i] = false;
+  }
+}
+
+#endif
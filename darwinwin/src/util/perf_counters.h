@@ -0,0 +1,46 @@
+#pragma once
+
+#include "core.h"
+
+enum perf_counter
+{
+  pc_Cycles,
+  pc_Instructions,
+  pc_L1DMisses,
+  pc_LLCMisses,
+  pc_BranchMisses,
+
+  _perf_counter_Count
+};
+
+const char *perf_counter_name(const perf_counter counter);
+
+// Hardware performance counters of the calling thread (user space only), read through `perf_event_open` on Linux.
+// Counters that the CPU, the kernel (see `/proc/sys/kernel/perf_event_paranoid`) or a VM don't provide are unavailable, everything else keeps working without them.
+struct perf_counters
+{
+  int32_t fd[_perf_counter_Count];
+  bool available[_perf_counter_Count] = {};
+  size_t availableCount = 0;
+
+  inline perf_counters() { for (size_t i = 0; i < _perf_counter_Count; i++) fd[i] = -1; };
+  inline perf_counters(const perf_counters &) = delete;
+  perf_counters &operator =(const perf_counters &) = delete;
+
+  ~perf_counters();
+};
+
+// Fails with `lsR_NotSupported` if no counter at all is available (e.g. on other platforms), so call it silently if that's expected.
+lsResult perf_counters_init(perf_counters *pCounters);
+void perf_counters_destroy(perf_counters *pCounters);
+
+// Resets and starts all available counters.
+void perf_counters_start(perf_counters *pCounters);
+
+// Stops counting without resetting or reading the counters, e.g. to exclude work between two measured parts.
+void perf_counters_pause(perf_counters *pCounters);
+void perf_counters_resume(perf_counters *pCounters);
+
+// Stops the counters. Values are scaled up if the kernel had to multiplex the counters.
+// Counters that are unavailable, couldn't be read or were never scheduled (e.g. starved by multiplexing) are marked as not `valid` and their `values` are set to 0.
+void perf_counters_stop(perf_counters *pCounters, _Out_ uint64_t (&values)[_perf_counter_Count], _Out_ bool (&valid)[_perf_counter_Count]);
@@ -72,6 +72,24 @@ lsResult read_byte_stream_read(raw_file_byte_stream_reader &stream, uint8_t *pDa
   return lsR_IOFailure;
 }
 
+lsResult read_byte_stream_seek(raw_file_byte_stream_reader &stream, const size_t position)
+{
+  lsResult result = lsR_Success;
+
+  LS_ERROR_IF(position > stream.size, lsR_ArgumentOutOfBounds);
+
+#ifdef LS_PLATFORM_WINDOWS
+  LS_ERROR_IF(0 != _fseeki64(reinterpret_cast<FILE *>(stream.pHandle), (int64_t)position, SEEK_SET), lsR_IOFailure);
+#else
+  LS_ERROR_IF(0 != fseeko(reinterpret_cast<FILE *>(stream.pHandle), (off_t)position, SEEK_SET), lsR_IOFailure);
+#endif
+
+  stream.position = position;
+
+epilogue:
+  return result;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 raw_file_byte_stream_writer::~raw_file_byte_stream_writer()
@@ -88,8 +106,13 @@ lsResult write_byte_stream_init(raw_file_byte_stream_writer &writer, const char
   writer.pHandle = fopen(filename, "wb");
   LS_ERROR_IF(writer.pHandle == nullptr, lsR_IOFailure);
 
+  writer.position = 0;
+
   if (append)
+  {
     fseek(reinterpret_cast<FILE *>(writer.pHandle), 0, SEEK_END);
+    writer.position = (size_t)ftell(reinterpret_cast<FILE *>(writer.pHandle));
+  }
 
 epilogue:
   return result;
@@ -112,6 +135,8 @@ lsResult write_byte_stream_append(raw_file_byte_stream_writer &writer, const uin
 {
   lsAssert(size < (size_t)lsMaxValue<int32_t>());
   const size_t written = fwrite(pData, 1, size, reinterpret_cast<FILE *>(writer.pHandle));
+  writer.position += written;
+
   return written == size ? lsR_Success : lsR_IOFailure;
 }
 
@@ -113,7 +113,34 @@ inline lsResult read_byte_stream_read(cached_byte_stream_reader<source_stream, b
     stream.position = stream.buffer_size;
     LS_ERROR_IF(remainingStreamSize < remainingSize, lsR_EndOfStream);
     LS_ERROR_CHECK(read_byte_stream_read(*stream.pSource, pData + initiallyAvailableSize, remainingSize));
-    stream.consumed_bytes += remainingSize;
+
+    // The buffer doesn't hold the bytes before the new position anymore, so it's dropped (otherwise seeking back could be served from it).
+    stream.consumed_bytes += stream.buffer_size + remainingSize;
+    stream.buffer_size = 0;
+    stream.position = 0;
+  }
+
+epilogue:
+  return result;
+}
+
+// Moves the read position to `position` bytes from the start of the stream. Stays within the buffer if possible.
+template <byte_stream_reader source_stream, size_t buffer_size_bits>
+inline lsResult read_byte_stream_seek(cached_byte_stream_reader<source_stream, buffer_size_bits> &stream, const size_t position)
+{
+  lsResult result = lsR_Success;
+
+  if (position >= stream.consumed_bytes && position <= stream.consumed_bytes + stream.buffer_size)
+  {
+    stream.position = position - stream.consumed_bytes;
+  }
+  else
+  {
+    LS_ERROR_CHECK(read_byte_stream_seek(*stream.pSource, position));
+
+    stream.consumed_bytes = position;
+    stream.buffer_size = 0;
+    stream.position = 0;
   }
 
 epilogue:
@@ -136,6 +163,7 @@ void read_byte_stream_destroy(raw_file_byte_stream_reader &stream);
 
 lsResult read_byte_stream_read(raw_file_byte_stream_reader &stream, uint8_t &value);
 lsResult read_byte_stream_read(raw_file_byte_stream_reader &stream, uint8_t *pData, const size_t size);
+lsResult read_byte_stream_seek(raw_file_byte_stream_reader &stream, const size_t position);
 
 inline size_t read_byte_stream_pos(const raw_file_byte_stream_reader &stream)
 {
@@ -252,11 +280,19 @@ epilogue:
   return result;
 }
 
+// Number of bytes appended to the stream so far (including the ones that haven't been flushed yet).
+template <byte_stream_writer target_stream, size_t buffer_size_bits>
+inline size_t write_byte_stream_pos(const cached_byte_stream_writer<target_stream, buffer_size_bits> &writer)
+{
+  return write_byte_stream_pos(*writer.pTarget) + writer.position;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 struct raw_file_byte_stream_writer
 {
   void *pHandle = nullptr;
+  size_t position = 0;
 
   ~raw_file_byte_stream_writer();
 };
@@ -266,6 +302,11 @@ void write_byte_stream_destroy(raw_file_byte_stream_writer &writer);
 lsResult write_byte_stream_append(raw_file_byte_stream_writer &writer, const uint8_t *pData, const size_t size);
 lsResult write_byte_stream_flush(raw_file_byte_stream_writer &writer);
 
+inline size_t write_byte_stream_pos(const raw_file_byte_stream_writer &writer)
+{
+  return writer.position;
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 template <size_t buffer_size_bits = 10>
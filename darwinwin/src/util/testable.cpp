@@ -1,7 +1,10 @@
 #include "testable.h"
+#include "thread_pool.h"
 
 #include <map>
 #include <vector>
+#include <mutex>
+#include <algorithm>
 
 static std::map<std::string, testable_func> *_pTests;
 
@@ -20,7 +23,68 @@ _testable_init register_testable(const char *name, testable_func func)
   return { _pTests->size() };
 }
 
-lsResult run_testables()
+struct testable_output_line
+{
+  lsPrintCallbackFunc *pCallback;
+  std::string text;
+};
+
+struct testable_run
+{
+  const char *name;
+  testable_func func;
+  lsResult result;
+  int64_t durationNs;
+  std::vector<testable_output_line> output; // only used when running concurrently.
+};
+
+// Whilst the tests run concurrently, the print callbacks are replaced, so that everything a test prints on its thread ends up in `_pOutput` and can be printed along with the result.
+static lsPrintCallbackFunc *_pPrintCallback = nullptr;
+static lsPrintCallbackFunc *_pPrintErrorCallback = nullptr;
+static lsPrintCallbackFunc *_pPrintLogCallback = nullptr;
+static thread_local std::vector<testable_output_line> *_pOutput = nullptr;
+
+template <lsPrintCallbackFunc **ppCallback>
+static void testable_bufferOutput_internal(const char *text)
+{
+  if (_pOutput != nullptr)
+    _pOutput->push_back({ *ppCallback, text });
+  else if (*ppCallback != nullptr)
+    (*ppCallback)(text);
+}
+
+static void testable_run_internal(testable_run *pRun)
+{
+  lsErrorPushSilentImpl _silent;
+
+  const int64_t before = lsGetCurrentTimeNs();
+
+  pRun->result = pRun->func();
+
+  pRun->durationNs = lsGetCurrentTimeNs() - before;
+}
+
+static void testable_printResult_internal(const testable_run &run)
+{
+  if (LS_FAILED(run.result))
+  {
+    lsSetConsoleColor(lsCC_BrightRed, lsCC_Black);
+    print("[XFAILED] ", run.name, " (in ", FF(Max(5))(run.durationNs * 1e-6f), " ms)\n");
+    lsResetConsoleColor();
+  }
+  else
+  {
+    lsSetConsoleColor(lsCC_BrightGreen, lsCC_Black);
+    print("[SUCCESS] ");
+    lsResetConsoleColor();
+    print(run.name);
+    lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
+    print(" (in ", FF(Max(5))(run.durationNs * 1e-6f), " ms)\n");
+    lsResetConsoleColor();
+  }
+}
+
+lsResult run_testables(const testable_options &options /* = {} */)
 {
   register_testable_files<testable_file_count>();
 
@@ -28,7 +92,9 @@ lsResult run_testables()
 
   size_t failed = 0;
   size_t succeeded = 0;
-  std::vector<const char *> failedTests;
+  std::vector<testable_run> runs;
+  int64_t before = 0;
+  int64_t totalNs = 0;
 
   if (_pTests == nullptr)
   {
@@ -36,59 +102,128 @@ lsResult run_testables()
     goto epilogue;
   }
 
-  print(_pTests->size(), " test(s) discovered.\n\n");
-
   for (const auto &_item : *_pTests)
+    if (options.filter == nullptr || _item.first.find(options.filter) != std::string::npos)
+      runs.push_back({ _item.first.c_str(), _item.second, lsR_Success, 0, {} });
+
+  print(_pTests->size(), " test(s) discovered");
+
+  if (options.filter != nullptr)
+    print(", ", runs.size(), " matching '", options.filter, "'");
+
+  if (options.threadCount > 1 && runs.size() > 1)
+    print(", running on ", options.threadCount, " threads");
+
+  print(".\n\n");
+
+  before = lsGetCurrentTimeNs();
+
+  if (options.threadCount > 1 && runs.size() > 1)
   {
-    lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
-    print("[RUNNING] ");
-    lsResetConsoleColor();
-    print(_item.first.c_str(), "\n");
+    thread_pool *pThreadPool = thread_pool_new(lsMin(options.threadCount, runs.size()));
+    std::mutex printMutex;
 
-    lsErrorPushSilentImpl _silent;
+    _pPrintCallback = lsPrintCallback;
+    _pPrintErrorCallback = lsPrintErrorCallback;
+    _pPrintLogCallback = lsPrintLogCallback;
 
-    const int64_t before = lsGetCurrentTimeNs();
+    lsPrintCallback = &testable_bufferOutput_internal<&_pPrintCallback>;
+    lsPrintErrorCallback = &testable_bufferOutput_internal<&_pPrintErrorCallback>;
+    lsPrintLogCallback = &testable_bufferOutput_internal<&_pPrintLogCallback>;
 
-    const lsResult r = _item.second();
+    // The results are printed as they come in, each one after the output of its test (apart from the output of threads started by the test itself), the summary below is in order again.
+    for (testable_run &run : runs)
+    {
+      testable_run *pRun = &run;
+
+      thread_pool_add(pThreadPool, [pRun, &printMutex]()
+        {
+          _pOutput = &pRun->output;
+          testable_run_internal(pRun);
+          _pOutput = nullptr;
+
+          std::scoped_lock lock(printMutex);
+
+          for (const testable_output_line &line : pRun->output)
+            lsPrintToFunction(line.pCallback, line.text.c_str());
+
+          testable_printResult_internal(*pRun);
+        });
+    }
+
+    thread_pool_await(pThreadPool);
+    thread_pool_destroy(&pThreadPool);
+
+    lsPrintCallback = _pPrintCallback;
+    lsPrintErrorCallback = _pPrintErrorCallback;
+    lsPrintLogCallback = _pPrintLogCallback;
+  }
+  else
+  {
+    for (testable_run &run : runs)
+    {
+      lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
+      print("[RUNNING] ");
+      lsResetConsoleColor();
+      print(run.name, "\n");
 
-    const int64_t after = lsGetCurrentTimeNs();
+      testable_run_internal(&run);
+      testable_printResult_internal(run);
+    }
+  }
 
-    if (LS_FAILED(r))
+  totalNs = lsGetCurrentTimeNs() - before;
+
+  for (const testable_run &run : runs)
+  {
+    if (LS_FAILED(run.result))
     {
       failed++;
       result = lsR_Failure;
-      lsSetConsoleColor(lsCC_BrightRed, lsCC_Black);
-      print("[XFAILED] ", _item.first.c_str(), " (in ", FF(Max(5))((after - before) * 1e-6f), " ms)\n");
-      lsResetConsoleColor();
-      failedTests.push_back(_item.first.c_str());
     }
     else
     {
       succeeded++;
-      lsSetConsoleColor(lsCC_BrightGreen, lsCC_Black);
-      print("[SUCCESS] ");
-      lsResetConsoleColor();
-      print(_item.first.c_str());
-      lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
-      print(" (in ", FF(Max(5))((after - before) * 1e-6f), " ms)\n");
-      lsResetConsoleColor();
     }
   }
 
   print("===========================================\n");
 
+  // The slowest tests, to see what holds up the start.
+  {
+    constexpr size_t maxSlowestCount = 5;
+
+    std::vector<const testable_run *> slowest;
+
+    for (const testable_run &run : runs)
+      slowest.push_back(&run);
+
+    std::sort(slowest.begin(), slowest.end(), [](const testable_run *a, const testable_run *b) { return a->durationNs > b->durationNs; });
+
+    lsSetConsoleColor(lsCC_DarkGray, lsCC_Black);
+    print("Ran ", runs.size(), " test(s) in ", FF(Max(5))(totalNs * 1e-6f), " ms. Slowest:\n");
+
+    for (size_t i = 0; i < slowest.size() && i < maxSlowestCount; i++)
+      print("  ", FS(slowest[i]->name, Min(40)), FF(Max(5))(slowest[i]->durationNs * 1e-6f), " ms\n");
+
+    lsResetConsoleColor();
+  }
+
   if (failed > 0)
   {
     lsSetConsoleColor(lsCC_BrightRed, lsCC_Black);
-    print(failed, " / ", _pTests->size(), " (", FD(Max(4))(failed / (double_t)_pTests->size() * 100.0), " %) Test(s) failed.\n");
-    for (const char *name : failedTests)
-      print("[XFAILED] ", name, "\n");
+    print(failed, " / ", runs.size(), " (", FD(Max(4))(failed / (double_t)runs.size() * 100.0), " %) Test(s) failed.\n");
+
+    for (const testable_run &run : runs)
+      if (LS_FAILED(run.result))
+        print("[XFAILED] ", run.name, "\n");
+
     lsResetConsoleColor();
   }
   else
   {
     lsSetConsoleColor(lsCC_BrightGreen, lsCC_Black);
-    print("All ", succeeded, " / ", _pTests->size(), " Test(s) succeeded.\n");
+    print("All ", succeeded, " / ", runs.size(), " Test(s) succeeded.\n");
     lsResetConsoleColor();
   }
 
@@ -6,7 +6,14 @@ struct _testable_init { size_t instanceId; };
 
 typedef lsResult(*testable_func)();
 _testable_init register_testable(const char *name, testable_func func);
-lsResult run_testables();
+
+struct testable_options
+{
+  const char *filter = nullptr; // only the tests whose name contains `filter` are run.
+  size_t threadCount = 1; // if > 1, the tests run concurrently on a `thread_pool` (tests can't depend on each other or share files) and the output of every test is printed along with its result.
+};
+
+lsResult run_testables(const testable_options &options = {});
 
 #define DEFINE_TESTABLE(name) \
   lsResult test_ ## name(); \
@@ -22,7 +29,7 @@ template <size_t n>
 void register_testable_files();
 
 #define REGISTER_TESTABLE_FILE(n) template <> void register_testable_files<n>() { if constexpr (n > 0) register_testable_files<n - 1>(); }
-constexpr size_t testable_file_count = 1; // <-- INCREMENT, when new tests are added.
+constexpr size_t testable_file_count = 6; // <-- INCREMENT, when new tests are added.
 
 template <typename T>
 inline void testable_print_value_of_type(const T &v)
@@ -1,12 +1,13 @@
 // Improved Version of https://github.com/rainerzufalldererste/slapcodec/blob/master/slapcodec/src/threadpool.cpp
 
 #include "thread_pool.h"
+#include "testable.h"
 
 #include <thread>
 #include <mutex>
-#include <queue>
 #include <atomic>
 #include <condition_variable>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -15,22 +16,329 @@
 #include <pthread.h>
 #endif
 
+REGISTER_TESTABLE_FILE(6);
+
+// Bounded lock-free multi-producer multi-consumer queue ("Bounded MPMC queue", Dmitry Vyukov).
+// Every cell has a sequence number that tells producers and consumers whose turn it is, so the task pointers in the cells are never accessed concurrently.
+struct thread_pool_ring
+{
+  struct cell
+  {
+    std::atomic<size_t> sequence;
+    thread_pool_task *pTask;
+  };
+
+  cell *pCells = nullptr;
+  size_t mask = 0;
+
+  alignas(64) std::atomic<size_t> enqueuePosition = 0;
+  alignas(64) std::atomic<size_t> dequeuePosition = 0;
+};
+
+static void thread_pool_ring_init(thread_pool_ring *pRing, const size_t capacity)
+{
+  pRing->pCells = new thread_pool_ring::cell[capacity];
+  pRing->mask = capacity - 1;
+
+  for (size_t i = 0; i < capacity; i++)
+    pRing->pCells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+static void thread_pool_ring_destroy(thread_pool_ring *pRing)
+{
+  delete[] pRing->pCells;
+  pRing->pCells = nullptr;
+}
+
+static bool thread_pool_ring_push(thread_pool_ring *pRing, thread_pool_task *pTask)
+{
+  size_t position = pRing->enqueuePosition.load(std::memory_order_relaxed);
+  thread_pool_ring::cell *pCell;
+
+  while (true)
+  {
+    pCell = &pRing->pCells[position & pRing->mask];
+    const intptr_t diff = (intptr_t)pCell->sequence.load(std::memory_order_acquire) - (intptr_t)position;
+
+    if (diff == 0)
+    {
+      if (pRing->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+    {
+      return false; // full.
+    }
+    else
+    {
+      position = pRing->enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  pCell->pTask = pTask;
+  pCell->sequence.store(position + 1, std::memory_order_release);
+
+  return true;
+}
+
+static thread_pool_task * thread_pool_ring_pop(thread_pool_ring *pRing)
+{
+  size_t position = pRing->dequeuePosition.load(std::memory_order_relaxed);
+  thread_pool_ring::cell *pCell;
+
+  while (true)
+  {
+    pCell = &pRing->pCells[position & pRing->mask];
+    const intptr_t diff = (intptr_t)pCell->sequence.load(std::memory_order_acquire) - (intptr_t)(position + 1);
+
+    if (diff == 0)
+    {
+      if (pRing->dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+    {
+      return nullptr; // empty (or the producer of the next cell isn't done yet).
+    }
+    else
+    {
+      position = pRing->dequeuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  thread_pool_task *pTask = pCell->pTask;
+  pCell->sequence.store(position + pRing->mask + 1, std::memory_order_release);
+
+  return pTask;
+}
+
+// Only an estimate whilst other threads push or pop.
+static size_t thread_pool_ring_size(const thread_pool_ring *pRing)
+{
+  const size_t dequeued = pRing->dequeuePosition.load(std::memory_order_relaxed);
+  const size_t enqueued = pRing->enqueuePosition.load(std::memory_order_relaxed);
+
+  return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// Chase-Lev work-stealing deque (with the memory orderings from "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al.).
+// Only the owning worker pushes and pops at the bottom (LIFO, so the most recently added - and still cached - task runs first), every other thread steals from the top.
+// The capacity is fixed, if it's full, tasks go to the shared ring of the pool instead.
+struct thread_pool_deque
+{
+  static constexpr int64_t capacity = 1024;
+  static_assert((capacity & (capacity - 1)) == 0, "Capacity must be a power of two.");
+
+  alignas(64) std::atomic<int64_t> top = 0;
+  alignas(64) std::atomic<int64_t> bottom = 0;
+  alignas(64) std::atomic<thread_pool_task *> tasks[capacity];
+};
+
+static bool thread_pool_deque_push(thread_pool_deque *pDeque, thread_pool_task *pTask)
+{
+  const int64_t b = pDeque->bottom.load(std::memory_order_relaxed);
+  const int64_t t = pDeque->top.load(std::memory_order_acquire);
+
+  if (b - t >= thread_pool_deque::capacity)
+    return false;
+
+  pDeque->tasks[b & (thread_pool_deque::capacity - 1)].store(pTask, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  pDeque->bottom.store(b + 1, std::memory_order_relaxed);
+
+  return true;
+}
+
+static thread_pool_task * thread_pool_deque_pop(thread_pool_deque *pDeque)
+{
+  const int64_t b = pDeque->bottom.load(std::memory_order_relaxed) - 1;
+  pDeque->bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = pDeque->top.load(std::memory_order_relaxed);
+
+  if (t > b) // empty.
+  {
+    pDeque->bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  thread_pool_task *pTask = pDeque->tasks[b & (thread_pool_deque::capacity - 1)].load(std::memory_order_relaxed);
+
+  if (t == b) // the last task, a thief may be racing us for it.
+  {
+    if (!pDeque->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      pTask = nullptr;
+
+    pDeque->bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  return pTask;
+}
+
+static thread_pool_task * thread_pool_deque_steal(thread_pool_deque *pDeque)
+{
+  int64_t t = pDeque->top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = pDeque->bottom.load(std::memory_order_acquire);
+
+  if (t >= b)
+    return nullptr;
+
+  thread_pool_task *pTask = pDeque->tasks[t & (thread_pool_deque::capacity - 1)].load(std::memory_order_relaxed);
+
+  if (!pDeque->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    return nullptr; // lost the race against the owner or another thief.
+
+  return pTask;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 struct thread_pool
 {
-  std::queue<std::function<void(void)>> tasks;
-  
+  static constexpr size_t taskCapacity = 4096;
+  static_assert((taskCapacity & (taskCapacity - 1)) == 0, "Task capacity must be a power of two.");
+
   std::thread *pThreads;
+  thread_pool_deque *pDeques; // one per thread.
   size_t threadCount;
 
-  std::atomic<size_t> taskCount;
+  thread_pool_task *pTaskSlots; // `taskCapacity` slots, every task that has been added but not yet run occupies one of them.
+  thread_pool_ring freeTaskSlots;
+  thread_pool_ring sharedTasks; // tasks added from outside the pool (or by a worker with a full deque). Can't overflow, as there aren't more slots than cells.
+
+  std::atomic<size_t> taskCount; // added, but not yet completed.
   std::atomic<bool> isRunning;
-  std::mutex mutex;
+
+  // Idle workers sleep until a task is added, `wakeEpoch` changes whenever sleeping workers are notified.
+  std::atomic<size_t> sleepingCount;
+  std::atomic<uint64_t> wakeEpoch;
+  std::mutex sleepMutex;
   std::condition_variable condition_var;
 
   thread_pool(const size_t threadCount);
   ~thread_pool();
 };
 
+// The worker that the current thread is (if any), so tasks added from within a task go to the local deque.
+static thread_local thread_pool *_pCurrentThreadPool = nullptr;
+static thread_local size_t _CurrentThreadIndex = 0;
+
+// The pool whose task the current thread is running (if any), this includes tasks that are run by a thread that helps out in `thread_pool_await` or whilst all slots are taken.
+static thread_local thread_pool *_pRunningTaskThreadPool = nullptr;
+
+static void thread_pool_wake_internal(thread_pool *pThreadPool)
+{
+  // Pairs with the fence in `thread_pool_sleep_internal`: either the sleeping worker sees the new task, or we see the worker.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (pThreadPool->sleepingCount.load(std::memory_order_relaxed) == 0)
+    return;
+
+  {
+    std::scoped_lock lock(pThreadPool->sleepMutex);
+    pThreadPool->wakeEpoch++;
+  }
+
+  pThreadPool->condition_var.notify_one();
+}
+
+// Takes a task from the shared ring. Workers move a share of the remaining tasks to their own deque, so the others can steal them from there without contending on the ring.
+static thread_pool_task * thread_pool_pop_shared_internal(thread_pool *pThreadPool, thread_pool_deque *pDeque)
+{
+  thread_pool_task *pTask = thread_pool_ring_pop(&pThreadPool->sharedTasks);
+
+  if (pTask == nullptr || pDeque == nullptr)
+    return pTask;
+
+  constexpr size_t maxBatchSize = 32;
+
+  size_t batchSize = thread_pool_ring_size(&pThreadPool->sharedTasks) / (pThreadPool->threadCount + 1);
+
+  if (batchSize > maxBatchSize)
+    batchSize = maxBatchSize;
+
+  size_t moved = 0;
+
+  for (; moved < batchSize; moved++)
+  {
+    thread_pool_task *pMovedTask = thread_pool_ring_pop(&pThreadPool->sharedTasks);
+
+    if (pMovedTask == nullptr)
+      break;
+
+    if (!thread_pool_deque_push(pDeque, pMovedTask))
+    {
+      LS_DEBUG_ASSERT_TRUE(thread_pool_ring_push(&pThreadPool->sharedTasks, pMovedTask)); // we just took it from there.
+      break;
+    }
+  }
+
+  if (moved > 0)
+    thread_pool_wake_internal(pThreadPool);
+
+  return pTask;
+}
+
+// `index` is `threadCount` for threads that don't belong to the pool.
+static thread_pool_task * thread_pool_find_task_internal(thread_pool *pThreadPool, const size_t index)
+{
+  thread_pool_deque *pDeque = index < pThreadPool->threadCount ? &pThreadPool->pDeques[index] : nullptr;
+  thread_pool_task *pTask = nullptr;
+
+  if (pDeque != nullptr && (pTask = thread_pool_deque_pop(pDeque)) != nullptr)
+    return pTask;
+
+  if ((pTask = thread_pool_pop_shared_internal(pThreadPool, pDeque)) != nullptr)
+    return pTask;
+
+  for (size_t i = 1; i <= pThreadPool->threadCount; i++)
+  {
+    const size_t victim = (index + i) % (pThreadPool->threadCount + 1);
+
+    if (victim < pThreadPool->threadCount && (pTask = thread_pool_deque_steal(&pThreadPool->pDeques[victim])) != nullptr)
+      return pTask;
+  }
+
+  return nullptr;
+}
+
+static void thread_pool_run_internal(thread_pool *pThreadPool, thread_pool_task *pTask)
+{
+  thread_pool *pPreviousThreadPool = _pRunningTaskThreadPool;
+  _pRunningTaskThreadPool = pThreadPool;
+
+  pTask->pRun(pTask);
+
+  _pRunningTaskThreadPool = pPreviousThreadPool;
+  LS_DEBUG_ASSERT_TRUE(thread_pool_ring_push(&pThreadPool->freeTaskSlots, pTask)); // there's a cell for every slot.
+
+  pThreadPool->taskCount--;
+}
+
+static void thread_pool_sleep_internal(thread_pool *pThreadPool, const size_t index)
+{
+  pThreadPool->sleepingCount++;
+  const uint64_t epoch = pThreadPool->wakeEpoch.load();
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // Tasks may have been added before we were counted as sleeping.
+  thread_pool_task *pTask = thread_pool_find_task_internal(pThreadPool, index);
+
+  if (pTask == nullptr)
+  {
+    std::unique_lock<std::mutex> lock(pThreadPool->sleepMutex);
+    pThreadPool->condition_var.wait(lock, [=]() { return pThreadPool->wakeEpoch.load() != epoch || !pThreadPool->isRunning; });
+  }
+
+  pThreadPool->sleepingCount--;
+
+  if (pTask != nullptr)
+    thread_pool_run_internal(pThreadPool, pTask);
+}
+
 void thread_pool_ThreadFunc(thread_pool *pThreadPool, const size_t index)
 {
 #ifdef _WIN32
@@ -45,39 +353,58 @@ void thread_pool_ThreadFunc(thread_pool *pThreadPool, const size_t index)
   pthread_setaffinity_np(current_thread, sizeof(cpu_set_t), &cpuset);
 #endif
 
+  _pCurrentThreadPool = pThreadPool;
+  _CurrentThreadIndex = index;
+
+  // Spin for a little while before going to sleep, tasks often come in bursts.
+  constexpr size_t maxIdleSpins = 64;
+  size_t idleSpins = 0;
+
   while (pThreadPool->isRunning)
   {
-    std::function<void(void)> task = nullptr;
+    thread_pool_task *pTask = thread_pool_find_task_internal(pThreadPool, index);
 
+    if (pTask != nullptr)
     {
-      std::unique_lock<std::mutex> lock(pThreadPool->mutex);
-      pThreadPool->condition_var.wait_for(lock, std::chrono::milliseconds(1));
-
-      if (!pThreadPool->tasks.empty())
-      {
-        task = pThreadPool->tasks.front();
-        pThreadPool->tasks.pop();
-      }
+      thread_pool_run_internal(pThreadPool, pTask);
+      idleSpins = 0;
     }
-
-    if (task)
+    else if (idleSpins < maxIdleSpins)
+    {
+      idleSpins++;
+      std::this_thread::yield();
+    }
+    else
     {
-      task();
-      --pThreadPool->taskCount;
-      continue;
+      thread_pool_sleep_internal(pThreadPool, index);
+      idleSpins = 0;
     }
   }
 }
 
 thread_pool::thread_pool(const size_t threads) :
-  tasks(),
   pThreads(nullptr),
+  pDeques(nullptr),
   threadCount(threads),
+  pTaskSlots(nullptr),
+  freeTaskSlots(),
+  sharedTasks(),
   taskCount(0),
   isRunning(true),
-  mutex(),
+  sleepingCount(0),
+  wakeEpoch(0),
+  sleepMutex(),
   condition_var()
 {
+  pDeques = new thread_pool_deque[threads];
+  pTaskSlots = new thread_pool_task[taskCapacity];
+
+  thread_pool_ring_init(&freeTaskSlots, taskCapacity);
+  thread_pool_ring_init(&sharedTasks, taskCapacity);
+
+  for (size_t i = 0; i < taskCapacity; i++)
+    LS_DEBUG_ASSERT_TRUE(thread_pool_ring_push(&freeTaskSlots, &pTaskSlots[i]));
+
   pThreads = reinterpret_cast<std::thread *>(malloc(sizeof(std::thread) * threads));
 
   for (size_t i = 0; i < threads; i++)
@@ -87,8 +414,12 @@ thread_pool::thread_pool(const size_t threads) :
 thread_pool::~thread_pool()
 {
   thread_pool_await(this);
-   
-  isRunning = false;
+
+  {
+    std::scoped_lock lock(sleepMutex);
+    isRunning = false;
+  }
+
   condition_var.notify_all();
 
   for (size_t i = 0; i < threadCount; i++)
@@ -98,6 +429,11 @@ thread_pool::~thread_pool()
   }
 
   free(pThreads);
+  delete[] pDeques;
+  delete[] pTaskSlots;
+
+  thread_pool_ring_destroy(&freeTaskSlots);
+  thread_pool_ring_destroy(&sharedTasks);
 }
 
 thread_pool * thread_pool_new(const size_t threads)
@@ -111,6 +447,7 @@ void thread_pool_destroy(thread_pool **ppThreadPool)
     return;
 
   delete *ppThreadPool;
+  *ppThreadPool = nullptr;
 }
 
 size_t thread_pool_thread_count(thread_pool *pPool)
@@ -121,52 +458,238 @@ size_t thread_pool_thread_count(thread_pool *pPool)
   return pPool->threadCount == 0 ? 1 : pPool->threadCount;
 }
 
-void thread_pool_add(thread_pool *pThreadPool, const std::function<void(void)> &task)
+thread_pool_task * thread_pool_acquire_task_internal(thread_pool *pThreadPool)
+{
+  thread_pool_task *pTask;
+
+  // All slots are taken: make room by running some of the tasks.
+  while ((pTask = thread_pool_ring_pop(&pThreadPool->freeTaskSlots)) == nullptr)
+  {
+    thread_pool_task *pPendingTask = thread_pool_find_task_internal(pThreadPool, _pCurrentThreadPool == pThreadPool ? _CurrentThreadIndex : pThreadPool->threadCount);
+
+    if (pPendingTask != nullptr)
+      thread_pool_run_internal(pThreadPool, pPendingTask);
+    else
+      std::this_thread::yield();
+  }
+
+  return pTask;
+}
+
+void thread_pool_submit_task_internal(thread_pool *pThreadPool, thread_pool_task *pTask)
 {
   pThreadPool->taskCount++;
 
-  pThreadPool->mutex.lock();
-  pThreadPool->tasks.push(task);
-  pThreadPool->mutex.unlock();
+  if (_pCurrentThreadPool != pThreadPool || !thread_pool_deque_push(&pThreadPool->pDeques[_CurrentThreadIndex], pTask))
+    LS_DEBUG_ASSERT_TRUE(thread_pool_ring_push(&pThreadPool->sharedTasks, pTask)); // can't overflow, as there aren't more slots than cells.
 
-  pThreadPool->condition_var.notify_one();
+  thread_pool_wake_internal(pThreadPool);
 }
 
 void thread_pool_await(thread_pool *pThreadPool)
 {
-  while (true)
+  // The running task is part of `taskCount`, so it would wait for itself.
+  lsAssert(_pRunningTaskThreadPool != pThreadPool);
+
+  // Help out until all tasks have been taken, then wait for the other threads to finish theirs.
+  const size_t index = _pCurrentThreadPool == pThreadPool ? _CurrentThreadIndex : pThreadPool->threadCount;
+
+  while (pThreadPool->taskCount > 0)
+  {
+    thread_pool_task *pTask = thread_pool_find_task_internal(pThreadPool, index);
+
+    if (pTask != nullptr)
+      thread_pool_run_internal(pThreadPool, pTask);
+    else
+      std::this_thread::yield();
+  }
+}
+
+size_t thread_pool_max_threads()
+{
+  return std::thread::hardware_concurrency();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+DEFINE_TESTABLE(thread_pool_stress_test)
+{
+  lsResult result = lsR_Success;
+
+  constexpr size_t cycleCount = 24;
+  constexpr size_t tinyTaskCount = 1500;
+  constexpr size_t parentCount = 16;
+  constexpr size_t childrenPerParent = 128;
+  constexpr size_t stolenChildCount = 64;
+  constexpr int64_t timeoutMs = 10000;
+
+  thread_pool *pThreadPool = nullptr;
+  std::vector<std::atomic<uint32_t>> runCounts(tinyTaskCount + parentCount * (childrenPerParent + 1));
+  std::atomic<size_t> stolenCount = 0;
+  std::atomic<bool> parentDone = false;
+  std::atomic<bool> timedOut = false;
+
+  const auto countNotRunOnce = [&]() { return std::count_if(runCounts.begin(), runCounts.end(), [](const std::atomic<uint32_t> &count) { return count.load() != 1; }); };
+
+  // New pools of different sizes, some are destroyed without awaiting them first.
+  for (size_t cycle = 0; cycle < cycleCount; cycle++)
   {
-    std::function<void(void)> task = nullptr;
+    const size_t threadCount = 2 + cycle % 3;
+    pThreadPool = thread_pool_new(threadCount);
+
+    for (std::atomic<uint32_t> &count : runCounts)
+      count = 0;
 
-    // Locked by mutex.
+    // The parent waits for its children without running them, they're in the deque of its worker, so only the other workers can steal them from there.
     {
-      pThreadPool->mutex.lock();
+      stolenCount = 0;
+      parentDone = false;
+      timedOut = false;
 
-      if (!pThreadPool->tasks.empty())
-      {
-        task = pThreadPool->tasks.front();
-        pThreadPool->tasks.pop();
-      }
+      thread_pool_add(pThreadPool, [pThreadPool, &stolenCount, &parentDone, &timedOut]()
+        {
+          for (size_t i = 0; i < stolenChildCount; i++)
+            thread_pool_add(pThreadPool, [&stolenCount]() { stolenCount++; });
+
+          const int64_t start = lsGetCurrentTimeMs();
+
+          while (stolenCount < stolenChildCount && !timedOut)
+          {
+            timedOut = lsGetCurrentTimeMs() - start > timeoutMs;
+            std::this_thread::yield();
+          }
+
+          parentDone = true;
+        });
 
-      pThreadPool->mutex.unlock();
+      // Don't help out, that would steal the children from this thread.
+      while (!parentDone)
+        std::this_thread::yield();
+
+      TESTABLE_ASSERT_FALSE(timedOut.load());
+      TESTABLE_ASSERT_EQUAL(stolenCount.load(), stolenChildCount);
     }
 
-    if (task)
+    // Many tiny tasks from outside of the pool.
+    for (size_t i = 0; i < tinyTaskCount; i++)
+      thread_pool_add(pThreadPool, [pCounts = runCounts.data(), i]() { pCounts[i]++; });
+
+    // Tasks that add tasks from inside the workers, these go to the deque of the worker.
+    for (size_t i = 0; i < parentCount; i++)
     {
-      task();
-      pThreadPool->taskCount--;
+      const size_t parentIndex = tinyTaskCount + i * (childrenPerParent + 1);
+
+      thread_pool_add(pThreadPool, [pThreadPool, pCounts = runCounts.data(), parentIndex]()
+        {
+          pCounts[parentIndex]++;
+
+          for (size_t j = 1; j <= childrenPerParent; j++)
+            thread_pool_add(pThreadPool, [pCounts, index = parentIndex + j]() { pCounts[index]++; });
+        });
     }
-    else
+
+    if (cycle % 2 == 0)
     {
-      break;
+      thread_pool_await(pThreadPool);
+      TESTABLE_ASSERT_EQUAL(countNotRunOnce(), (ptrdiff_t)0);
     }
+
+    // Destroying the pool completes the remaining tasks.
+    thread_pool_destroy(&pThreadPool);
+    TESTABLE_ASSERT_EQUAL(pThreadPool, (thread_pool *)nullptr);
+    TESTABLE_ASSERT_EQUAL(countNotRunOnce(), (ptrdiff_t)0);
+    TESTABLE_ASSERT_EQUAL(stolenCount.load(), stolenChildCount);
   }
 
-  while (pThreadPool->taskCount > 0)
-    std::this_thread::yield(); // Wait for all other threads to finish their tasks.
+epilogue:
+  thread_pool_destroy(&pThreadPool);
+  return result;
 }
 
-size_t thread_pool_max_threads()
+DEFINE_TESTABLE(thread_pool_exhaustion_test)
 {
-  return std::thread::hardware_concurrency();
+  lsResult result = lsR_Success;
+
+  constexpr size_t taskCount = thread_pool::taskCapacity * 3;
+  constexpr int64_t timeoutMs = 10000;
+
+  thread_pool *pThreadPool = nullptr;
+  std::vector<std::atomic<uint32_t>> runCounts(taskCount);
+  std::atomic<bool> blockerStarted = false;
+  std::atomic<bool> gateOpen = false;
+  std::atomic<bool> parentDone = false;
+  std::atomic<bool> timedOut = false;
+  size_t ranWhilstAdding = 0;
+
+  const std::thread::id addingThread = std::this_thread::get_id();
+  const auto countNotRunOnce = [&]() { return std::count_if(runCounts.begin(), runCounts.end(), [](const std::atomic<uint32_t> &count) { return count.load() != 1; }); };
+
+  // From outside of the pool: the only worker is blocked until one of the tasks runs on the adding thread, that only happens once all slots are taken.
+  {
+    pThreadPool = thread_pool_new(1);
+
+    thread_pool_add(pThreadPool, [&blockerStarted, &gateOpen, &timedOut]()
+      {
+        blockerStarted = true;
+
+        const int64_t start = lsGetCurrentTimeMs();
+
+        while (!gateOpen && !timedOut)
+        {
+          timedOut = lsGetCurrentTimeMs() - start > timeoutMs;
+          std::this_thread::yield();
+        }
+      });
+
+    while (!blockerStarted)
+      std::this_thread::yield();
+
+    for (size_t i = 0; i < taskCount; i++)
+      thread_pool_add(pThreadPool, [pCounts = runCounts.data(), i, &gateOpen, addingThread]()
+        {
+          pCounts[i]++;
+
+          if (std::this_thread::get_id() == addingThread)
+            gateOpen = true;
+        });
+
+    thread_pool_await(pThreadPool);
+
+    TESTABLE_ASSERT_FALSE(timedOut.load());
+    TESTABLE_ASSERT_TRUE(gateOpen.load());
+    TESTABLE_ASSERT_EQUAL(countNotRunOnce(), (ptrdiff_t)0);
+
+    thread_pool_destroy(&pThreadPool);
+  }
+
+  for (std::atomic<uint32_t> &count : runCounts)
+    count = 0;
+
+  // From inside of the only worker, whilst this thread doesn't help out: all tasks that complete before the parent does have been run by the worker whilst it was waiting for a free slot.
+  {
+    pThreadPool = thread_pool_new(1);
+
+    thread_pool_add(pThreadPool, [pThreadPool, pCounts = runCounts.data(), &ranWhilstAdding, &parentDone]()
+      {
+        for (size_t i = 0; i < taskCount; i++)
+          thread_pool_add(pThreadPool, [pCounts, i]() { pCounts[i]++; });
+
+        ranWhilstAdding = (size_t)std::count_if(pCounts, pCounts + taskCount, [](const std::atomic<uint32_t> &count) { return count.load() != 0; });
+        parentDone = true;
+      });
+
+    while (!parentDone)
+      std::this_thread::yield();
+
+    TESTABLE_ASSERT_TRUE(ranWhilstAdding >= taskCount - thread_pool::taskCapacity);
+
+    thread_pool_await(pThreadPool);
+    TESTABLE_ASSERT_EQUAL(countNotRunOnce(), (ptrdiff_t)0);
+
+    thread_pool_destroy(&pThreadPool);
+  }
+
+epilogue:
+  thread_pool_destroy(&pThreadPool);
+  return result;
 }
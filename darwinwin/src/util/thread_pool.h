@@ -2,7 +2,10 @@
 #define thread_pool_h__
 
 #include <stddef.h>
-#include <functional>
+#include <stdint.h>
+#include <new>
+#include <utility>
+#include <type_traits>
 
 struct thread_pool;
 
@@ -11,7 +14,43 @@ void thread_pool_destroy(thread_pool **ppThreadPool);
 
 size_t thread_pool_thread_count(thread_pool *pThreadPool);
 
-void thread_pool_add(thread_pool *pThreadPool, const std::function<void(void)> &func);
+// A task slot of the pool. The function is constructed in place and is never copied or moved until it has been run.
+struct thread_pool_task
+{
+  static constexpr size_t capacity = 64;
+
+  alignas(16) uint8_t data[capacity];
+  void (*pRun)(thread_pool_task *pTask); // calls and destroys the stored function.
+};
+
+// Blocks (and runs other tasks of the pool) whilst all slots are in use.
+thread_pool_task * thread_pool_acquire_task_internal(thread_pool *pThreadPool);
+void thread_pool_submit_task_internal(thread_pool *pThreadPool, thread_pool_task *pTask);
+
+// Doesn't allocate, the function is stored inline in one of the task slots of the pool. Capture larger state by reference.
+template <typename func_t>
+inline void thread_pool_add(thread_pool *pThreadPool, func_t &&func)
+{
+  typedef std::decay_t<func_t> stored_t;
+
+  static_assert(sizeof(stored_t) <= thread_pool_task::capacity, "Task is too large to be stored inline. Capture by reference instead.");
+  static_assert(alignof(stored_t) <= alignof(thread_pool_task), "Task requires stricter alignment than a task slot provides.");
+
+  thread_pool_task *pTask = thread_pool_acquire_task_internal(pThreadPool);
+
+  new (pTask->data) stored_t(std::forward<func_t>(func));
+
+  pTask->pRun = [](thread_pool_task *pSelf)
+    {
+      stored_t *pFunc = std::launder(reinterpret_cast<stored_t *>(pSelf->data));
+      (*pFunc)();
+      pFunc->~stored_t();
+    };
+
+  thread_pool_submit_task_internal(pThreadPool, pTask);
+}
+
+// Runs tasks of the pool until all tasks that have been added (including the ones added by other tasks in the meantime) have completed. Must not be called from within a task of the same pool.
 void thread_pool_await(thread_pool *pThreadPool);
 
 size_t thread_pool_max_threads();